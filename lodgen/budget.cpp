@@ -0,0 +1,164 @@
+#include "budget.hpp"
+#include <algorithm>
+
+namespace lodgen
+{
+
+// Curve sample points: 0.7^k of the source triangles, down to about 0.1%.
+static std::vector<float> curveRatios()
+{
+    std::vector<float> ratios;
+    for ( float r = 0.7f; r > 0.0008f; r *= 0.7f )
+        ratios.push_back( r );
+    return ratios;
+}
+
+// Bytes of one vertex with every stream the mesh carries.
+static double vertexBytes( const aiMesh* mesh )
+{
+    double bytes = sizeof( aiVector3D );
+    if ( mesh->mNormals )    bytes += sizeof( aiVector3D );
+    if ( mesh->mTangents )   bytes += sizeof( aiVector3D );
+    if ( mesh->mBitangents ) bytes += sizeof( aiVector3D );
+    for ( unsigned int ch = 0; ch < AI_MAX_NUMBER_OF_TEXTURECOORDS; ++ch )
+        if ( mesh->mTextureCoords[ch] )
+            bytes += mesh->mNumUVComponents[ch] * sizeof( float );
+    for ( unsigned int ch = 0; ch < AI_MAX_NUMBER_OF_COLOR_SETS; ++ch )
+        if ( mesh->mColors[ch] )
+            bytes += sizeof( aiColor4D );
+    return bytes;
+}
+
+static void countInstances( const aiNode* node, std::vector<unsigned int>& counts )
+{
+    if ( !node )
+        return;
+    for ( unsigned int i = 0; i < node->mNumMeshes; ++i )
+        if ( node->mMeshes[i] < counts.size() )
+            ++counts[node->mMeshes[i]];
+    for ( unsigned int c = 0; c < node->mNumChildren; ++c )
+        countInstances( node->mChildren[c], counts );
+}
+
+BudgetPlanner::BudgetPlanner(
+    const aiScene* scene, const SimplifyOptions& opts, ThreadPool* pool, std::span<const unsigned int> twins )
+    : m_meshCount( scene->mNumMeshes )
+{
+    std::vector<unsigned int> instances( scene->mNumMeshes, 0 );
+    countInstances( scene->mRootNode, instances );
+
+    for ( unsigned int m = 0; m < scene->mNumMeshes; ++m )
+    {
+        const aiMesh* mesh = scene->mMeshes[m];
+        // A mesh no node references is still exported; count it once.
+        const double count = std::max( instances[m], 1u );
+
+        if ( !canSimplify( mesh ) )
+        {
+            size_t indexCount = 0;
+            for ( unsigned int f = 0; f < mesh->mNumFaces; ++f )
+                indexCount += mesh->mFaces[f].mNumIndices;
+            if ( mesh->mPrimitiveTypes & ( aiPrimitiveType_TRIANGLE | aiPrimitiveType_POLYGON ) )
+                m_fixedTriangles += count * mesh->mNumFaces;
+            m_fixedBytes += mesh->mNumVertices * vertexBytes( mesh ) + indexCount * sizeof( unsigned int );
+            continue;
+        }
+
+        MeshCost cost;
+        cost.instances        = count;
+        cost.bytesPerTriangle = 3 * sizeof( unsigned int ) +
+                                vertexBytes( mesh ) * mesh->mNumVertices / mesh->mNumFaces;
+        m_meshes.push_back( std::move( cost ) );
+        m_meshIndex.push_back( m );
+    }
+
+    // Errors in model units, so meshes of different size compare directly.
+    SimplifyOptions curveOpts = opts;
+    curveOpts.absoluteError   = true;
+    const std::vector<float> ratios = curveRatios();
+
+    // Entry of m_meshes per scene mesh, to find a twin's curve.
+    std::vector<size_t> entry( scene->mNumMeshes, 0 );
+    for ( size_t i = 0; i < m_meshIndex.size(); ++i )
+        entry[m_meshIndex[i]] = i;
+    auto isTwin = [&]( size_t i ) { return !twins.empty() && twins[m_meshIndex[i]] != m_meshIndex[i]; };
+
+    auto buildCurve = [&]( size_t i ) {
+        if ( isTwin( i ) )
+            return;
+        const aiMesh* mesh = scene->mMeshes[m_meshIndex[i]];
+        auto& curve = m_meshes[i].curve;
+        curve.push_back( { mesh->mNumFaces, 0.0f } );
+        for ( const auto& p : errorCurve( mesh, ratios, curveOpts ) )
+            curve.push_back( { p.triangles, std::max( p.error, curve.back().error ) } );
+    };
+    if ( pool )
+        pool->parallelFor( m_meshes.size(), buildCurve );
+    else
+        for ( size_t i = 0; i < m_meshes.size(); ++i )
+            buildCurve( i );
+    for ( size_t i = 0; i < m_meshes.size(); ++i )
+        if ( isTwin( i ) )
+            m_meshes[i].curve = m_meshes[entry[twins[m_meshIndex[i]]]].curve;
+
+    for ( const auto& mesh : m_meshes )
+        m_maxError = std::max( m_maxError, mesh.curve.back().error );
+}
+
+// Triangles left at `error`: the curve interpolated linearly between samples.
+double BudgetPlanner::trianglesAt( const MeshCost& mesh, float error ) const
+{
+    const auto& curve = mesh.curve;
+    auto it = std::upper_bound( curve.begin(), curve.end(), error,
+                                []( float e, const ErrorCurvePoint& p ) { return e < p.error; } );
+    if ( it == curve.end() )
+        return curve.back().triangles;
+
+    // `it` is the first sample above `error`; curve[0] has error 0, so it has a predecessor.
+    const auto& lo = *( it - 1 );
+    const auto& hi = *it;
+    const double t = ( error - lo.error ) / ( hi.error - lo.error );
+    return lo.triangles + t * ( double( hi.triangles ) - double( lo.triangles ) );
+}
+
+double BudgetPlanner::costAt( float error, bool bytes ) const
+{
+    double total = bytes ? m_fixedBytes : m_fixedTriangles;
+    for ( const auto& mesh : m_meshes )
+        total += trianglesAt( mesh, error ) * ( bytes ? mesh.bytesPerTriangle : mesh.instances );
+    return total;
+}
+
+// Smallest error at which the scene costs at most `limit`.
+float BudgetPlanner::solve( uint64_t limit, bool bytes ) const
+{
+    if ( limit == 0 || costAt( 0.0f, bytes ) <= double( limit ) )
+        return 0.0f;
+    if ( costAt( m_maxError, bytes ) > double( limit ) )
+        return m_maxError;
+
+    float lo = 0.0f, hi = m_maxError;
+    for ( int i = 0; i < 48; ++i )
+    {
+        const float mid = 0.5f * ( lo + hi );
+        ( costAt( mid, bytes ) <= double( limit ) ? hi : lo ) = mid;
+    }
+    return hi;
+}
+
+std::vector<float> BudgetPlanner::meshRatios( const LodBudget& budget, float* error ) const
+{
+    const float limit = std::max( solve( budget.triangles, false ), solve( budget.bytes, true ) );
+    if ( error )
+        *error = limit;
+
+    std::vector<float> ratios( m_meshCount, 1.0f );
+    for ( size_t i = 0; i < m_meshes.size(); ++i )
+    {
+        const auto& mesh = m_meshes[i];
+        ratios[m_meshIndex[i]] = static_cast<float>( trianglesAt( mesh, limit ) / mesh.curve.front().triangles );
+    }
+    return ratios;
+}
+
+} // namespace lodgen
@@ -0,0 +1,61 @@
+#pragma once
+#include "mesh_simplifier.hpp"
+#include "thread_pool.hpp"
+#include <assimp/scene.h>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace lodgen
+{
+
+// What one LOD of a whole scene may cost; 0 = no limit.
+struct LodBudget
+{
+    uint64_t triangles = 0; // drawn triangles: a mesh counts once per node instancing it
+    uint64_t bytes     = 0; // estimated vertex + index memory: a mesh counts once
+
+    bool empty() const { return triangles == 0 && bytes == 0; }
+};
+
+// Splits scene-wide budgets into per-mesh ratios.
+//
+// Every simplifiable mesh gets an error curve (errorCurve, in model units)
+// once. A budget is then met by the smallest single error limit at which all
+// meshes, each simplified as far as that limit allows, fit into it: meshes
+// whose triangles go away cheaply give up more of them than meshes where every
+// removal shows, and the largest error left in the scene is as small as the
+// budget permits. Meshes that are not simplified count at their full cost.
+class BudgetPlanner
+{
+public:
+    // Twins (see findMeshTwins) copy the curve of the mesh they repeat.
+    BudgetPlanner( const aiScene* scene, const SimplifyOptions& opts, ThreadPool* pool = nullptr,
+                   std::span<const unsigned int> twins = {} );
+
+    // Ratio per mesh (indexed like mMeshes) to meet `budget`, 1 for meshes
+    // that are not simplified. If even the coarsest curve points do not fit,
+    // those are returned. `error`, if set, receives the limit the ratios aim at.
+    std::vector<float> meshRatios( const LodBudget& budget, float* error = nullptr ) const;
+
+private:
+    struct MeshCost
+    {
+        std::vector<ErrorCurvePoint> curve; // from ( source triangles, 0 ), errors ascending
+        double instances        = 1;
+        double bytesPerTriangle = 0;        // indices + the share of vertices, from the source
+    };
+
+    double trianglesAt( const MeshCost& mesh, float error ) const;
+    double costAt( float error, bool bytes ) const;
+    float  solve( uint64_t limit, bool bytes ) const;
+
+    std::vector<MeshCost> m_meshes;             // simplifiable meshes only
+    std::vector<size_t>   m_meshIndex;          // scene index of each entry of m_meshes
+    size_t                m_meshCount      = 0;
+    double                m_fixedTriangles = 0; // meshes that are not simplified
+    double                m_fixedBytes     = 0;
+    float                 m_maxError       = 0; // largest error on any curve
+};
+
+} // namespace lodgen
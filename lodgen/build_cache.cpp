@@ -0,0 +1,249 @@
+#include "build_cache.hpp"
+#include <charconv>
+#include <cstdio>
+#include <fstream>
+#include <thread>
+
+namespace lodgen
+{
+
+// Bump when the entry layout changes.
+static constexpr std::string_view kRecordHeader = "lodgen-cache 4";
+
+void ContentHash::add( const void* data, size_t size )
+{
+    const auto* bytes = static_cast<const unsigned char*>( data );
+    uint64_t h = m_hash;
+    for ( size_t i = 0; i < size; ++i )
+    {
+        h ^= bytes[i];
+        h *= 1099511628211ull;
+    }
+    m_hash = h;
+}
+
+bool ContentHash::addFile( const fs::path& path )
+{
+    std::ifstream in( path, std::ios::binary );
+    if ( !in )
+    {
+        add( std::string_view( "<missing>" ) );
+        return false;
+    }
+
+    std::vector<char> buf( 1 << 16 );
+    uint64_t total = 0;
+    while ( in )
+    {
+        in.read( buf.data(), static_cast<std::streamsize>( buf.size() ) );
+        const auto n = static_cast<size_t>( in.gcount() );
+        add( buf.data(), n );
+        total += n;
+    }
+    add( total );
+    return true;
+}
+
+std::vector<CacheDependency> hashDependencies( const fs::path& baseDir, const std::vector<fs::path>& paths )
+{
+    std::vector<CacheDependency> deps;
+    deps.reserve( paths.size() );
+    for ( const auto& p : paths )
+    {
+        ContentHash h;
+        h.addFile( baseDir / p );
+        deps.push_back( { p, h.value() } );
+    }
+    return deps;
+}
+
+// ── BuildCache ────────────────────────────────────────────────────────────────
+
+BuildCache::BuildCache( fs::path dir )
+    : m_dir( std::move( dir ) )
+{
+}
+
+fs::path BuildCache::entryDir( uint64_t key ) const
+{
+    char hex[17];
+    std::snprintf( hex, sizeof( hex ), "%016llx", static_cast<unsigned long long>( key ) );
+    return m_dir / hex;
+}
+
+// Hard-link `from` to `to`, falling back to a copy (e.g. across filesystems).
+static bool linkOrCopy( const fs::path& from, const fs::path& to )
+{
+    std::error_code ec;
+    fs::create_directories( to.parent_path(), ec );
+    fs::remove( to, ec );
+    fs::create_hard_link( from, to, ec );
+    if ( ec )
+        fs::copy_file( from, to, fs::copy_options::overwrite_existing, ec );
+    return !ec;
+}
+
+std::optional<std::string> BuildCache::restore( uint64_t key, const fs::path& baseDir, const fs::path& outputDir )
+{
+    const fs::path entry = entryDir( key );
+    std::ifstream in( entry / "record", std::ios::binary );
+    if ( !in )
+        return std::nullopt;
+
+    std::string line;
+    if ( !std::getline( in, line ) || line != kRecordHeader )
+        return std::nullopt;
+
+    size_t depCount = 0;
+    if ( !( in >> depCount ) )
+        return std::nullopt;
+    std::getline( in, line );
+
+    for ( size_t i = 0; i < depCount; ++i )
+    {
+        // "<hash hex> <relative path>"
+        if ( !std::getline( in, line ) || line.size() < 18 )
+            return std::nullopt;
+        uint64_t hash = 0;
+        std::from_chars( line.data(), line.data() + 16, hash, 16 );
+
+        ContentHash h;
+        h.addFile( baseDir / fs::path( line.substr( 17 ) ) );
+        if ( h.value() != hash )
+            return std::nullopt;
+    }
+
+    size_t fileCount = 0;
+    if ( !( in >> fileCount ) )
+        return std::nullopt;
+    std::getline( in, line );
+
+    std::vector<fs::path> stored;
+    stored.reserve( fileCount );
+    for ( size_t i = 0; i < fileCount; ++i )
+    {
+        if ( !std::getline( in, line ) || line.empty() )
+            return std::nullopt;
+        stored.emplace_back( line );
+    }
+
+    std::string record( std::istreambuf_iterator<char>( in ), {} );
+
+    for ( const auto& f : stored )
+        if ( !linkOrCopy( entry / "files" / f, outputDir / f ) )
+            return std::nullopt;
+
+    return record;
+}
+
+VoidResult BuildCache::store( uint64_t key,
+                              const std::vector<CacheDependency>& deps,
+                              const fs::path& outputDir,
+                              const std::vector<fs::path>& files,
+                              const std::string& record )
+{
+    const fs::path entry = entryDir( key );
+    const fs::path temp  = entry.string() + ".tmp" +
+                           std::to_string( std::hash<std::thread::id>{}( std::this_thread::get_id() ) ) +
+                           "-" + std::to_string( m_tempCounter.fetch_add( 1 ) );
+
+    auto fail = [&]( const std::string& what ) -> VoidResult {
+        std::error_code ignored;
+        fs::remove_all( temp, ignored );
+        return std::unexpected( Error{ ErrorCode::ExportFailed, "Build cache: " + what } );
+    };
+
+    std::error_code ec;
+    fs::create_directories( temp / "files", ec );
+    if ( ec )
+        return fail( "could not create " + temp.string() + ": " + ec.message() );
+
+    for ( const auto& f : files )
+        if ( !linkOrCopy( outputDir / f, temp / "files" / f ) )
+            return fail( "could not store " + ( outputDir / f ).string() );
+
+    {
+        std::ofstream out( temp / "record", std::ios::binary );
+        out << kRecordHeader << '\n' << deps.size() << '\n';
+        for ( const auto& d : deps )
+        {
+            char hex[17];
+            std::snprintf( hex, sizeof( hex ), "%016llx", static_cast<unsigned long long>( d.hash ) );
+            out << hex << ' ' << d.path.generic_string() << '\n';
+        }
+        out << files.size() << '\n';
+        for ( const auto& f : files )
+            out << f.generic_string() << '\n';
+        out << record;
+        if ( !out )
+            return fail( "could not write record for " + entry.string() );
+    }
+
+    // An existing entry for this key has stale dependencies; replace it. It
+    // is moved aside first so that no reader sees it half-deleted.
+    const fs::path stale = temp.string() + ".old";
+    fs::rename( entry, stale, ec );
+    fs::rename( temp, entry, ec );
+    if ( ec )
+    {
+        // Lost a race against another writer of the same key — theirs is as good.
+        fs::remove_all( temp, ec );
+    }
+    fs::remove_all( stale, ec );
+    return {};
+}
+
+FileSnapshot snapshotFiles( const fs::path& dir )
+{
+    FileSnapshot files;
+    std::error_code ec;
+    for ( auto it = fs::recursive_directory_iterator( dir, ec );
+          !ec && it != fs::recursive_directory_iterator(); it.increment( ec ) )
+    {
+        std::error_code fileEc;
+        if ( !it->is_regular_file( fileEc ) )
+            continue;
+        auto time = it->last_write_time( fileEc );
+        if ( !fileEc )
+            files.emplace( fs::relative( it->path(), dir ), time );
+    }
+    return files;
+}
+
+std::vector<fs::path> filesChangedSince( const fs::path& dir, const FileSnapshot& before )
+{
+    std::vector<fs::path> changed;
+    for ( const auto& [path, time] : snapshotFiles( dir ) )
+    {
+        auto it = before.find( path );
+        if ( it == before.end() || it->second != time )
+            changed.push_back( path );
+    }
+    return changed;
+}
+
+void detachRestoredFiles( const fs::path& dir )
+{
+    std::error_code ec;
+    std::vector<fs::path> linked;
+    for ( auto it = fs::recursive_directory_iterator( dir, ec );
+          !ec && it != fs::recursive_directory_iterator(); it.increment( ec ) )
+    {
+        std::error_code fileEc;
+        if ( it->is_regular_file( fileEc ) && it->hard_link_count( fileEc ) > 1 && !fileEc )
+            linked.push_back( it->path() );
+    }
+
+    // Copy aside and rename over, so the path gets its own inode.
+    for ( const auto& p : linked )
+    {
+        fs::path temp = p;
+        temp += ".detach";
+        if ( fs::copy_file( p, temp, fs::copy_options::overwrite_existing, ec ) )
+            fs::rename( temp, p, ec );
+        else
+            fs::remove( p, ec );
+    }
+}
+
+} // namespace lodgen
@@ -0,0 +1,104 @@
+#pragma once
+#include "types.hpp"
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+namespace lodgen
+{
+
+// Bump whenever a lodgen change alters the files generated from unchanged
+// inputs, so stale cache entries are never restored.
+inline constexpr unsigned int kOutputVersion = 4;
+
+// 64-bit FNV-1a over everything that determines an output.
+class ContentHash
+{
+public:
+    void add( const void* data, size_t size );
+    void add( std::string_view s ) { add( s.size() ); add( s.data(), s.size() ); }
+
+    template <typename T>
+        requires std::is_arithmetic_v<T>
+    void add( T value ) { add( &value, sizeof( value ) ); }
+
+    // File contents; false (and nothing hashed but a marker) if unreadable.
+    bool addFile( const fs::path& path );
+
+    uint64_t value() const { return m_hash; }
+
+private:
+    uint64_t m_hash = 14695981039346656037ull;
+};
+
+// A file an entry was built from and the hash of its contents at that time.
+struct CacheDependency
+{
+    fs::path path;  // relative to the entry's base directory
+    uint64_t hash = 0;
+};
+
+// Hash `paths` (relative to baseDir). Missing files hash as a fixed marker.
+std::vector<CacheDependency> hashDependencies( const fs::path& baseDir, const std::vector<fs::path>& paths );
+
+// On-disk cache of generated files.
+//
+// An entry is addressed by a key that hashes the primary input and every
+// option affecting the output, and records the secondary inputs it was built
+// from (textures, material libraries, ...) with their hashes. It only hits
+// while all of those still hash the same, so a changed texture invalidates
+// every model using it without hashing it into each key up front.
+//
+// Layout: <dir>/<key>/record (dependencies, stored files + caller record
+// text) and <dir>/<key>/files/... (outputs, relative to the output directory).
+// Entries are written to a temporary directory and renamed into place, so
+// concurrent writers of one key never leave a half-written entry; a replaced
+// entry is moved aside before it is deleted. restore links exactly the files
+// its record lists, so a reader racing a replacement fails rather than
+// restoring part of the outputs.
+class BuildCache
+{
+public:
+    explicit BuildCache( fs::path dir );
+
+    const fs::path& dir() const { return m_dir; }
+
+    // If `key` has an entry whose dependencies (resolved against baseDir) are
+    // unchanged, hard-link its files into outputDir (copying where linking is
+    // not possible) and return its record text. Restored files share storage
+    // with the cache: replace them, never modify them in place.
+    std::optional<std::string> restore( uint64_t key, const fs::path& baseDir, const fs::path& outputDir );
+
+    // Store `files` (relative to outputDir) under `key`. Dependencies are
+    // hashed by the caller before the build so inputs it consumes still count.
+    VoidResult store( uint64_t key,
+                      const std::vector<CacheDependency>& deps,
+                      const fs::path& outputDir,
+                      const std::vector<fs::path>& files,
+                      const std::string& record );
+
+private:
+    fs::path entryDir( uint64_t key ) const;
+
+    fs::path              m_dir;
+    std::atomic<uint64_t> m_tempCounter{ 0 };
+};
+
+// Regular files below `dir` (relative to it) with their modification times.
+using FileSnapshot = std::map<fs::path, fs::file_time_type>;
+FileSnapshot snapshotFiles( const fs::path& dir );
+
+// Files below `dir` that are new or modified since `before` was taken.
+std::vector<fs::path> filesChangedSince( const fs::path& dir, const FileSnapshot& before );
+
+// Give every file below `dir` that shares its inode with another path (i.e.
+// was restored from a cache entry) its own copy, so a rebuild that rewrites
+// it in place cannot write through into the cache.
+void detachRestoredFiles( const fs::path& dir );
+
+} // namespace lodgen
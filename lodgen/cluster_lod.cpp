@@ -0,0 +1,378 @@
+#include "cluster_lod.hpp"
+#include "face_arena.hpp"
+#include "mesh_simplifier.hpp"
+#include "scratch_arena.hpp"
+#include "simplify_attributes.hpp"
+#include <meshoptimizer.h>
+#include <algorithm>
+#include <cfloat>
+#include <cstring>
+#include <fstream>
+#include <numeric>
+#include <span>
+
+namespace lodgen
+{
+
+// A group whose simplification keeps more than this share of its triangles is
+// stuck (mostly locked border); its clusters become the coarsest of their part.
+static constexpr float kStuckRatio = 0.85f;
+
+struct WorkCluster
+{
+    std::vector<unsigned int>  vertices;  // meshlet vertices, into the mesh
+    std::vector<unsigned char> triangles; // 3 per triangle, into `vertices`
+    meshopt_Bounds             cull;
+    ClodBounds                 self;
+    ClodBounds                 parent;
+    uint32_t                   group = ~0u;
+    uint32_t                   depth = 0;
+};
+
+static ClodBounds sphereBounds( const float* center, float radius, float error )
+{
+    return { { center[0], center[1], center[2] }, radius, error };
+}
+
+// ── Clusterization ───────────────────────────────────────────────────────────
+
+static std::vector<WorkCluster> clusterize(
+    std::span<const unsigned int> indices, const float* positions, size_t vertexCount,
+    const ClusterLodOptions& opts, uint32_t depth )
+{
+    ScratchArena::Scope scratch;
+
+    ScratchVector<meshopt_Meshlet> meshlets(
+        meshopt_buildMeshletsBound( indices.size(), opts.maxVertices, opts.maxTriangles ) );
+    ScratchVector<unsigned int>  meshletVertices( indices.size() );
+    ScratchVector<unsigned char> meshletTriangles( indices.size() );
+    meshlets.resize( meshopt_buildMeshlets(
+        meshlets.data(), meshletVertices.data(), meshletTriangles.data(), indices.data(), indices.size(),
+        positions, vertexCount, kPosStride, opts.maxVertices, opts.maxTriangles, 0.25f ) );
+
+    std::vector<WorkCluster> clusters( meshlets.size() );
+    for ( size_t i = 0; i < meshlets.size(); ++i )
+    {
+        const meshopt_Meshlet& m = meshlets[i];
+        unsigned int*  mv = meshletVertices.data() + m.vertex_offset;
+        unsigned char* mt = meshletTriangles.data() + m.triangle_offset;
+        meshopt_optimizeMeshlet( mv, mt, m.triangle_count, m.vertex_count );
+
+        WorkCluster& c = clusters[i];
+        c.vertices.assign( mv, mv + m.vertex_count );
+        c.triangles.assign( mt, mt + m.triangle_count * 3 );
+        c.cull   = meshopt_computeMeshletBounds( mv, mt, m.triangle_count, positions, vertexCount, kPosStride );
+        c.self   = sphereBounds( c.cull.center, c.cull.radius, 0.0f );
+        c.parent = sphereBounds( c.cull.center, c.cull.radius, FLT_MAX );
+        c.depth  = depth;
+    }
+    return clusters;
+}
+
+// ── Grouping ─────────────────────────────────────────────────────────────────
+//
+// Clusters are grouped, and group borders locked, by position (positionOf), so
+// UV and normal seams inside the mesh do not count as borders.
+
+static std::vector<std::vector<size_t>> partition(
+    const std::vector<WorkCluster>& clusters, const std::vector<size_t>& pending,
+    std::span<const unsigned int> positionOf, const float* positions, const ClusterLodOptions& opts )
+{
+    if ( pending.size() <= opts.groupSize )
+        return { pending };
+
+    ScratchArena::Scope scratch;
+    ScratchVector<unsigned int> clusterIndices;
+    ScratchVector<unsigned int> clusterIndexCounts( pending.size() );
+    for ( size_t i = 0; i < pending.size(); ++i )
+    {
+        const WorkCluster& c = clusters[pending[i]];
+        for ( unsigned char t : c.triangles )
+            clusterIndices.push_back( positionOf[c.vertices[t]] );
+        clusterIndexCounts[i] = static_cast<unsigned int>( c.triangles.size() );
+    }
+
+    ScratchVector<unsigned int> groupOf( pending.size() );
+    const size_t groupCount = meshopt_partitionClusters(
+        groupOf.data(), clusterIndices.data(), clusterIndices.size(), clusterIndexCounts.data(), pending.size(),
+        positions, positionOf.size(), kPosStride, opts.groupSize );
+
+    std::vector<std::vector<size_t>> groups( groupCount );
+    for ( size_t i = 0; i < pending.size(); ++i )
+        groups[groupOf[i]].push_back( pending[i] );
+    return groups;
+}
+
+// Lock every vertex at a position used by more than one group, or by a
+// retired cluster: those stay drawn at their own level, so their borders must
+// never move.
+static void lockGroupBorders(
+    const std::vector<WorkCluster>& clusters, const std::vector<std::vector<size_t>>& groups,
+    std::span<const unsigned int> positionOf, std::span<const unsigned char> retired, std::span<unsigned int> owner,
+    std::span<unsigned char> lock )
+{
+    std::fill( owner.begin(), owner.end(), ~0u );
+    std::fill( lock.begin(), lock.end(), 0 );
+    for ( size_t g = 0; g < groups.size(); ++g )
+        for ( size_t c : groups[g] )
+            for ( unsigned int v : clusters[c].vertices )
+            {
+                unsigned int& o = owner[positionOf[v]];
+                if ( o == ~0u )
+                    o = static_cast<unsigned int>( g );
+                else if ( o != g )
+                    lock[positionOf[v]] = meshopt_SimplifyVertex_Lock;
+            }
+    for ( size_t v = 0; v < lock.size(); ++v )
+        lock[v] = retired[positionOf[v]] ? meshopt_SimplifyVertex_Lock : lock[positionOf[v]];
+}
+
+// ── DAG ──────────────────────────────────────────────────────────────────────
+
+ClusterLod buildClusterLod( const aiMesh* mesh, const ClusterLodOptions& opts, ThreadPool* pool )
+{
+    installMeshoptAllocator();
+
+    ClusterLod result;
+    if ( !canSimplify( mesh ) )
+        return result;
+
+    ScratchArena::Scope scratch;
+    const float* positions   = positionsOf( mesh );
+    const size_t vertexCount = mesh->mNumVertices;
+    const SimplifyAttributes attrs = buildSimplifyAttributes( mesh );
+
+    ScratchVector<unsigned int> indices( faceIndexCount( mesh ) );
+    copyFaceIndices( mesh, indices );
+
+    ScratchVector<unsigned int> positionOf( vertexCount );
+    meshopt_generatePositionRemap( positionOf.data(), positions, vertexCount, kPosStride );
+    ScratchVector<unsigned int>  owner( vertexCount );
+    ScratchVector<unsigned char> lock( vertexCount );
+    ScratchVector<unsigned char> retired( vertexCount, 0 ); // by position: touched by a stuck group
+
+    std::vector<WorkCluster> clusters = clusterize( indices, positions, vertexCount, opts, 0 );
+    std::vector<size_t> pending( clusters.size() );
+    std::iota( pending.begin(), pending.end(), size_t( 0 ) );
+
+    struct GroupResult
+    {
+        std::vector<WorkCluster> clusters; // empty if stuck
+        ClodBounds               bounds;
+    };
+
+    for ( uint32_t depth = 0; pending.size() > 1; ++depth )
+    {
+        const auto groups = partition( clusters, pending, positionOf, positions, opts );
+        lockGroupBorders( clusters, groups, positionOf, retired, owner, lock );
+
+        std::vector<GroupResult> groupResults( groups.size() );
+        auto simplifyGroup = [&]( size_t g ) {
+            ScratchArena::Scope groupScratch; // this thread's temporaries
+            size_t mergedCount = 0;
+            for ( size_t c : groups[g] )
+                mergedCount += clusters[c].triangles.size();
+            ScratchVector<unsigned int> merged;
+            merged.reserve( mergedCount );
+            for ( size_t c : groups[g] )
+                for ( unsigned char t : clusters[c].triangles )
+                    merged.push_back( clusters[c].vertices[t] );
+
+            const size_t target = static_cast<size_t>( merged.size() / 3 * opts.levelRatio ) * 3;
+            ScratchVector<unsigned int> simplified( merged.size() );
+            float error = 0;
+            simplified.resize( meshopt_simplifyWithAttributes(
+                simplified.data(), merged.data(), merged.size(),
+                positions, vertexCount, kPosStride,
+                attrs.data.data(), attrs.stride, attrs.weights.data(), attrs.count,
+                lock.data(), target, FLT_MAX, meshopt_SimplifySparse | meshopt_SimplifyErrorAbsolute, &error ) );
+            if ( simplified.empty() || simplified.size() > merged.size() * kStuckRatio )
+                return;
+
+            // Sphere around the children's spheres and at least their error,
+            // so both grow monotonically up the DAG.
+            ScratchVector<ClodBounds> children;
+            for ( size_t c : groups[g] )
+            {
+                children.push_back( clusters[c].self );
+                error = std::max( error, clusters[c].self.error );
+            }
+            const meshopt_Bounds sphere = meshopt_computeSphereBounds(
+                children[0].center, children.size(), sizeof( ClodBounds ), &children[0].radius, sizeof( ClodBounds ) );
+
+            GroupResult& r = groupResults[g];
+            r.bounds   = sphereBounds( sphere.center, sphere.radius, error );
+            r.clusters = clusterize( simplified, positions, vertexCount, opts, depth + 1 );
+        };
+        if ( pool )
+            pool->parallelFor( groups.size(), simplifyGroup );
+        else
+            for ( size_t g = 0; g < groups.size(); ++g )
+                simplifyGroup( g );
+
+        pending.clear();
+        for ( size_t g = 0; g < groups.size(); ++g )
+        {
+            GroupResult& r = groupResults[g];
+            if ( r.clusters.empty() )
+            {
+                // Stuck: its clusters keep parent error FLT_MAX and retire.
+                for ( size_t c : groups[g] )
+                    for ( unsigned int v : clusters[c].vertices )
+                        retired[positionOf[v]] = 1;
+                continue;
+            }
+
+            const uint32_t group = result.groupCount++;
+            for ( size_t c : groups[g] )
+            {
+                clusters[c].group  = group;
+                clusters[c].parent = r.bounds;
+            }
+            for ( WorkCluster& c : r.clusters )
+            {
+                c.self = r.bounds;
+                pending.push_back( clusters.size() );
+                clusters.push_back( std::move( c ) );
+            }
+        }
+    }
+
+    // ── Flatten ──
+    result.clusters.reserve( clusters.size() );
+    for ( const WorkCluster& c : clusters )
+    {
+        ClodCluster out{};
+        out.self   = c.self;
+        out.parent = c.parent;
+        std::copy_n( c.cull.center, 3, out.cullCenter );
+        out.cullRadius = c.cull.radius;
+        std::copy_n( c.cull.cone_axis_s8, 3, out.coneAxis );
+        out.coneCutoff     = c.cull.cone_cutoff_s8;
+        out.vertexOffset   = static_cast<uint32_t>( result.meshletVertices.size() );
+        out.triangleOffset = static_cast<uint32_t>( result.meshletTriangles.size() / 3 );
+        out.vertexCount    = static_cast<uint16_t>( c.vertices.size() );
+        out.triangleCount  = static_cast<uint16_t>( c.triangles.size() / 3 );
+        out.group          = c.group;
+        out.depth          = c.depth;
+        result.clusters.push_back( out );
+
+        result.meshletVertices.insert( result.meshletVertices.end(), c.vertices.begin(), c.vertices.end() );
+        result.meshletTriangles.insert( result.meshletTriangles.end(), c.triangles.begin(), c.triangles.end() );
+        result.levelCount = std::max( result.levelCount, c.depth + 1 );
+    }
+    return result;
+}
+
+// ── .clod writer ─────────────────────────────────────────────────────────────
+
+static std::vector<float> interleaveVertices( const aiMesh* mesh, uint32_t format )
+{
+    std::vector<float> out;
+    out.reserve( size_t( mesh->mNumVertices ) * 8 );
+    for ( unsigned int v = 0; v < mesh->mNumVertices; ++v )
+    {
+        const aiVector3D& p = mesh->mVertices[v];
+        out.insert( out.end(), { p.x, p.y, p.z } );
+        if ( format & ClodVertexNormal )
+        {
+            const aiVector3D& n = mesh->mNormals[v];
+            out.insert( out.end(), { n.x, n.y, n.z } );
+        }
+        if ( format & ClodVertexUV )
+        {
+            const aiVector3D& uv = mesh->mTextureCoords[0][v];
+            out.insert( out.end(), { uv.x, uv.y } );
+        }
+    }
+    return out;
+}
+
+Result<ClusterLodInfo> writeClusterLod(
+    const aiScene* scene, const fs::path& path, const ClusterLodOptions& opts, ThreadPool* pool )
+{
+    if ( opts.maxVertices < 3 || opts.maxVertices > 256 || opts.maxTriangles < 1 || opts.maxTriangles > 512 ||
+         opts.groupSize < 2 || !( opts.levelRatio > 0.0f && opts.levelRatio < 1.0f ) )
+        return std::unexpected( Error{ ErrorCode::ExportFailed,
+            "Cluster LOD: clusters need 3-256 vertices, 1-512 triangles, groups of 2 or more and a level ratio in (0, 1)" } );
+
+    std::vector<unsigned int> meshes;
+    for ( unsigned int m = 0; m < scene->mNumMeshes; ++m )
+        if ( canSimplify( scene->mMeshes[m] ) )
+            meshes.push_back( m );
+
+    std::vector<ClusterLod> lods( meshes.size() );
+    auto build = [&]( size_t i ) { lods[i] = buildClusterLod( scene->mMeshes[meshes[i]], opts, pool ); };
+    if ( pool )
+        pool->parallelFor( meshes.size(), build );
+    else
+        for ( size_t i = 0; i < meshes.size(); ++i )
+            build( i );
+
+    ClusterLodInfo info;
+    info.outputPath = path;
+    info.meshCount  = static_cast<unsigned int>( meshes.size() );
+
+    ClodHeader header{};
+    std::memcpy( header.magic, kClodMagic, sizeof( header.magic ) );
+    header.version   = kClodVersion;
+    header.meshCount = info.meshCount;
+
+    // Data blocks follow the entries, mesh by mesh, each 4-byte aligned.
+    std::vector<ClodMeshEntry> entries( meshes.size() );
+    uint64_t offset = sizeof( ClodHeader ) + entries.size() * sizeof( ClodMeshEntry );
+    for ( size_t i = 0; i < meshes.size(); ++i )
+    {
+        const aiMesh*     mesh = scene->mMeshes[meshes[i]];
+        const ClusterLod& lod  = lods[i];
+        ClodMeshEntry&    e    = entries[i];
+
+        e.sourceMesh    = meshes[i];
+        e.materialIndex = mesh->mMaterialIndex;
+        e.vertexCount   = mesh->mNumVertices;
+        e.vertexFormat  = ( mesh->mNormals ? uint32_t( ClodVertexNormal ) : 0u )
+                        | ( mesh->mTextureCoords[0] ? uint32_t( ClodVertexUV ) : 0u );
+        e.vertexStride  = sizeof( float ) * ( 3 + ( mesh->mNormals ? 3 : 0 ) + ( mesh->mTextureCoords[0] ? 2 : 0 ) );
+        e.clusterCount  = static_cast<uint32_t>( lod.clusters.size() );
+        e.groupCount    = lod.groupCount;
+        e.levelCount    = lod.levelCount;
+        e.meshletVertexCount   = static_cast<uint32_t>( lod.meshletVertices.size() );
+        e.meshletTriangleCount = static_cast<uint32_t>( lod.meshletTriangles.size() / 3 );
+
+        e.vertexOffset          = offset; offset += uint64_t( e.vertexCount ) * e.vertexStride;
+        e.clusterOffset         = offset; offset += lod.clusters.size() * sizeof( ClodCluster );
+        e.meshletVertexOffset   = offset; offset += lod.meshletVertices.size() * sizeof( uint32_t );
+        e.meshletTriangleOffset = offset; offset += lod.meshletTriangles.size();
+        offset = ( offset + 3 ) & ~uint64_t( 3 );
+
+        info.clusterCount   += e.clusterCount;
+        info.levelCount      = std::max( info.levelCount, lod.levelCount );
+        info.sourceTriangles += mesh->mNumFaces;
+    }
+
+    std::ofstream out( path, std::ios::binary );
+    if ( !out )
+        return std::unexpected( Error{ ErrorCode::ExportFailed, "Could not write " + path.string() } );
+
+    auto write = [&]( const void* data, size_t bytes ) { out.write( static_cast<const char*>( data ), bytes ); };
+    write( &header, sizeof( header ) );
+    write( entries.data(), entries.size() * sizeof( ClodMeshEntry ) );
+    for ( size_t i = 0; i < meshes.size(); ++i )
+    {
+        const ClusterLod& lod = lods[i];
+        const std::vector<float> vertices = interleaveVertices( scene->mMeshes[meshes[i]], entries[i].vertexFormat );
+        write( vertices.data(), vertices.size() * sizeof( float ) );
+        write( lod.clusters.data(), lod.clusters.size() * sizeof( ClodCluster ) );
+        write( lod.meshletVertices.data(), lod.meshletVertices.size() * sizeof( uint32_t ) );
+        write( lod.meshletTriangles.data(), lod.meshletTriangles.size() );
+        static constexpr char kPad[4] = {};
+        write( kPad, ( 4 - lod.meshletTriangles.size() % 4 ) % 4 );
+    }
+    if ( !out.flush() )
+        return std::unexpected( Error{ ErrorCode::ExportFailed, "Could not write " + path.string() } );
+
+    info.bytesWritten = offset;
+    return info;
+}
+
+} // namespace lodgen
@@ -0,0 +1,134 @@
+#pragma once
+#include "types.hpp"
+#include "thread_pool.hpp"
+#include <assimp/mesh.h>
+#include <assimp/scene.h>
+#include <cstdint>
+#include <vector>
+
+namespace lodgen
+{
+
+// Hierarchical cluster LOD: instead of a few discrete levels, every mesh
+// becomes a DAG of small clusters (meshlets) that a renderer selects per
+// cluster, so detail changes locally without popping.
+//
+// The source triangles are split into clusters. Repeatedly, neighbouring
+// clusters are partitioned into groups, each group is simplified to about
+// half its triangles with the vertices it shares with other groups locked,
+// and the result is split into new clusters. Locked group borders keep
+// clusters of different levels crack-free where they meet; the next level's
+// groups form across the old borders so those get simplified in turn.
+//
+// Selection: a cluster is drawn when its own error is acceptable and its
+// parent's is not, each projected from its sphere:
+//     accept( self ) && !accept( parent )
+// Errors and spheres are those of whole groups and grow monotonically up the
+// DAG, so exactly one cluster covers every part of the surface for any
+// threshold (as in Nanite).
+
+// ── .clod file layout ────────────────────────────────────────────────────────
+//
+// Little-endian. ClodHeader, then meshCount ClodMeshEntry, then the data
+// blocks the entries point at (byte offsets from the start of the file).
+
+inline constexpr char     kClodMagic[4] = { 'C', 'L', 'O', 'D' };
+inline constexpr uint32_t kClodVersion  = 1;
+
+enum ClodVertexFormat : uint32_t
+{
+    ClodVertexNormal = 1, // float3 after the position
+    ClodVertexUV     = 2, // float2 (first UV channel) after that
+};
+
+struct ClodHeader
+{
+    char     magic[4];
+    uint32_t version;
+    uint32_t meshCount;
+    uint32_t reserved;
+};
+
+struct ClodMeshEntry
+{
+    uint32_t sourceMesh;    // index into the scene's mMeshes
+    uint32_t materialIndex;
+    uint32_t vertexCount;
+    uint32_t vertexFormat;  // ClodVertexFormat bits; float3 position always first
+    uint32_t vertexStride;  // bytes
+    uint32_t clusterCount;
+    uint32_t groupCount;
+    uint32_t levelCount;    // DAG depth + 1
+    uint32_t meshletVertexCount;
+    uint32_t meshletTriangleCount;
+    uint64_t vertexOffset;          // vertexCount * vertexStride bytes, interleaved
+    uint64_t clusterOffset;         // ClodCluster[clusterCount]
+    uint64_t meshletVertexOffset;   // uint32_t[meshletVertexCount], into the vertices
+    uint64_t meshletTriangleOffset; // uint8_t[3 * meshletTriangleCount], into a cluster's meshlet vertices
+};
+
+struct ClodBounds
+{
+    float center[3];
+    float radius;
+    float error;     // in model units
+};
+
+struct ClodCluster
+{
+    ClodBounds self;           // group that produced this cluster; error 0 for source clusters
+    ClodBounds parent;         // group it was simplified in; error FLT_MAX if none (coarsest)
+    float      cullCenter[3];  // sphere of the cluster's own triangles, for culling
+    float      cullRadius;
+    int8_t     coneAxis[3];    // backface cone, snorm8 (see meshopt_Bounds)
+    int8_t     coneCutoff;
+    uint32_t   vertexOffset;   // first meshlet vertex
+    uint32_t   triangleOffset; // first meshlet triangle
+    uint16_t   vertexCount;
+    uint16_t   triangleCount;
+    uint32_t   group;          // group it was simplified in, ~0u if none
+    uint32_t   depth;          // 0 for source clusters
+};
+
+static_assert( sizeof( ClodMeshEntry ) == 72 && sizeof( ClodCluster ) == 80 );
+
+// ── Building ─────────────────────────────────────────────────────────────────
+
+struct ClusterLodOptions
+{
+    unsigned int maxVertices  = 64;   // per cluster, <= 256
+    unsigned int maxTriangles = 124;  // per cluster, <= 512
+    unsigned int groupSize    = 16;   // clusters per group (meshopt_partitionClusters target)
+    float        levelRatio   = 0.5f; // triangles a group keeps per level
+};
+
+struct ClusterLod
+{
+    std::vector<ClodCluster>   clusters;         // level by level, source clusters first
+    std::vector<uint32_t>      meshletVertices;
+    std::vector<uint8_t>       meshletTriangles; // 3 per triangle
+    uint32_t                   groupCount = 0;
+    uint32_t                   levelCount = 0;
+};
+
+// The cluster DAG of one triangle mesh (canSimplify), over its own vertices.
+// With a pool, the groups of each level are simplified concurrently; the
+// result does not depend on it.
+ClusterLod buildClusterLod( const aiMesh* mesh, const ClusterLodOptions& opts = {}, ThreadPool* pool = nullptr );
+
+struct ClusterLodInfo
+{
+    fs::path     outputPath;
+    unsigned int meshCount    = 0; // meshes in the file; others are not triangle meshes
+    unsigned int clusterCount = 0;
+    unsigned int levelCount   = 0; // deepest mesh
+    uint64_t     sourceTriangles = 0;
+    uint64_t     bytesWritten    = 0;
+};
+
+// buildClusterLod for every triangle mesh of `scene`, written as one .clod
+// file. With a pool, meshes and the groups within each run concurrently.
+Result<ClusterLodInfo> writeClusterLod(
+    const aiScene* scene, const fs::path& path, const ClusterLodOptions& opts = {}, ThreadPool* pool = nullptr );
+
+} // namespace lodgen
@@ -0,0 +1,209 @@
+#include "cow_scene.hpp"
+#include "face_arena.hpp"
+#include <assimp/SceneCombiner.h>
+#include <cstring>
+
+namespace lodgen
+{
+
+template <typename T>
+static T** borrowArray( T* const* src, unsigned int count )
+{
+    if ( count == 0 )
+        return nullptr;
+    T** arr = new T*[count];
+    std::memcpy( arr, src, count * sizeof( T* ) );
+    return arr;
+}
+
+CowScene::CowScene( const aiScene* source )
+{
+    m_scene = new aiScene();
+    m_scene->mFlags = source->mFlags;
+    m_scene->mName  = source->mName;
+
+    m_scene->mNumMeshes    = source->mNumMeshes;
+    m_scene->mMeshes       = borrowArray( source->mMeshes, source->mNumMeshes );
+    m_scene->mNumMaterials = source->mNumMaterials;
+    m_scene->mMaterials    = borrowArray( source->mMaterials, source->mNumMaterials );
+    m_scene->mNumTextures  = source->mNumTextures;
+    m_scene->mTextures     = borrowArray( source->mTextures, source->mNumTextures );
+
+    // Never modified by lodgen — share the source arrays outright.
+    m_scene->mRootNode      = source->mRootNode;
+    m_scene->mNumAnimations = source->mNumAnimations;
+    m_scene->mAnimations    = source->mAnimations;
+    m_scene->mNumCameras    = source->mNumCameras;
+    m_scene->mCameras       = source->mCameras;
+    m_scene->mNumLights     = source->mNumLights;
+    m_scene->mLights        = source->mLights;
+    m_scene->mNumSkeletons  = source->mNumSkeletons;
+    m_scene->mSkeletons     = source->mSkeletons;
+    m_scene->mMetaData      = source->mMetaData;
+
+    m_meshes.assign( source->mNumMeshes, Share::Borrowed );
+    m_materials.assign( source->mNumMaterials, Share::Borrowed );
+    m_textures.assign( source->mNumTextures, Share::Borrowed );
+}
+
+CowScene::~CowScene()
+{
+    // Detach everything borrowed so ~aiScene only frees what the view owns.
+    // Entries past the tracked range were added by a stage and are owned.
+    for ( unsigned int i = 0; i < m_scene->mNumMeshes && i < m_meshes.size(); ++i )
+    {
+        if ( m_meshes[i] == Share::Borrowed )
+            m_scene->mMeshes[i] = nullptr;
+        else if ( m_meshes[i] == Share::Header )
+            releaseHeader( m_scene->mMeshes[i] );
+    }
+    for ( unsigned int i = 0; i < m_scene->mNumMaterials && i < m_materials.size(); ++i )
+        if ( m_materials[i] == Share::Borrowed )
+            m_scene->mMaterials[i] = nullptr;
+    for ( unsigned int i = 0; i < m_scene->mNumTextures && i < m_textures.size(); ++i )
+        if ( m_textures[i] == Share::Borrowed )
+            m_scene->mTextures[i] = nullptr;
+
+    // Owned meshes may have been rewritten into contiguous face storage.
+    releaseFaceArenas( m_scene );
+
+    m_scene->mRootNode      = nullptr;
+    m_scene->mNumAnimations = 0;
+    m_scene->mAnimations    = nullptr;
+    m_scene->mNumCameras    = 0;
+    m_scene->mCameras       = nullptr;
+    m_scene->mNumLights     = 0;
+    m_scene->mLights        = nullptr;
+    m_scene->mNumSkeletons  = 0;
+    m_scene->mSkeletons     = nullptr;
+    m_scene->mMetaData      = nullptr;
+
+    delete m_scene;
+}
+
+// Null every shared pointer of a header so its destructor frees only the header.
+void CowScene::releaseHeader( aiMesh* header )
+{
+    header->mVertices   = nullptr;
+    header->mNormals    = nullptr;
+    header->mTangents   = nullptr;
+    header->mBitangents = nullptr;
+    for ( auto& c : header->mColors )        c = nullptr;
+    for ( auto& t : header->mTextureCoords ) t = nullptr;
+    header->mTextureCoordsNames = nullptr;
+    header->mNumFaces      = 0;
+    header->mFaces         = nullptr;
+    header->mNumBones      = 0;
+    header->mBones         = nullptr;
+    header->mNumAnimMeshes = 0;
+    header->mAnimMeshes    = nullptr;
+}
+
+aiMesh* CowScene::mutableMesh( unsigned int i )
+{
+    if ( m_meshes[i] == Share::Owned )
+        return m_scene->mMeshes[i];
+
+    aiMesh* shared = m_scene->mMeshes[i];
+    aiMesh* copy   = nullptr;
+    Assimp::SceneCombiner::Copy( &copy, shared );
+
+    if ( m_meshes[i] == Share::Header )
+    {
+        releaseHeader( shared );
+        delete shared;
+    }
+
+    m_scene->mMeshes[i] = copy;
+    m_meshes[i]         = Share::Owned;
+    return copy;
+}
+
+aiMesh* CowScene::meshHeader( unsigned int i )
+{
+    if ( m_meshes[i] != Share::Borrowed )
+        return m_scene->mMeshes[i];
+
+    m_scene->mMeshes[i] = new aiMesh( *m_scene->mMeshes[i] );
+    m_meshes[i]         = Share::Header;
+    return m_scene->mMeshes[i];
+}
+
+void CowScene::shareMesh( unsigned int i, unsigned int from )
+{
+    aiMesh* own    = m_scene->mMeshes[i];
+    aiMesh* header = new aiMesh( *m_scene->mMeshes[from] );
+    header->mName          = own->mName;
+    header->mMaterialIndex = own->mMaterialIndex;
+
+    if ( m_meshes[i] == Share::Owned )
+    {
+        releaseFaceArena( own );
+        delete own;
+    }
+    else if ( m_meshes[i] == Share::Header )
+    {
+        releaseHeader( own );
+        delete own;
+    }
+
+    m_scene->mMeshes[i] = header;
+    m_meshes[i]         = Share::Header;
+}
+
+aiMaterial* CowScene::mutableMaterial( unsigned int i )
+{
+    if ( m_materials[i] == Share::Borrowed )
+    {
+        aiMaterial* copy = nullptr;
+        Assimp::SceneCombiner::Copy( &copy, m_scene->mMaterials[i] );
+        m_scene->mMaterials[i] = copy;
+        m_materials[i]         = Share::Owned;
+    }
+    return m_scene->mMaterials[i];
+}
+
+aiTexture* CowScene::mutableTexture( unsigned int i )
+{
+    if ( m_textures[i] == Share::Borrowed )
+    {
+        aiTexture* copy = nullptr;
+        Assimp::SceneCombiner::Copy( &copy, m_scene->mTextures[i] );
+        m_scene->mTextures[i] = copy;
+        m_textures[i]         = Share::Owned;
+    }
+    return m_scene->mTextures[i];
+}
+
+void CowScene::remapMaterials( const std::vector<unsigned int>& remap, unsigned int newCount )
+{
+    aiMaterial**       kept = newCount ? new aiMaterial*[newCount] : nullptr;
+    std::vector<Share> keptShare( newCount, Share::Borrowed );
+
+    for ( unsigned int i = 0; i < m_scene->mNumMaterials; ++i )
+    {
+        if ( remap[i] != ~0u )
+        {
+            kept[remap[i]]      = m_scene->mMaterials[i];
+            keptShare[remap[i]] = m_materials[i];
+        }
+        else if ( m_materials[i] == Share::Owned )
+        {
+            delete m_scene->mMaterials[i];
+        }
+    }
+
+    delete[] m_scene->mMaterials;
+    m_scene->mMaterials    = kept;
+    m_scene->mNumMaterials = newCount;
+    m_materials            = std::move( keptShare );
+
+    for ( unsigned int m = 0; m < m_scene->mNumMeshes; ++m )
+    {
+        unsigned int old = m_scene->mMeshes[m]->mMaterialIndex;
+        if ( old < remap.size() && remap[old] != ~0u && remap[old] != old )
+            meshHeader( m )->mMaterialIndex = remap[old];
+    }
+}
+
+} // namespace lodgen
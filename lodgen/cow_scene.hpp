@@ -0,0 +1,66 @@
+#pragma once
+#include "types.hpp"
+#include <assimp/scene.h>
+#include <vector>
+
+namespace lodgen
+{
+
+// Copy-on-write view of a read-only source scene.
+//
+// The view owns its own mesh / material / texture pointer arrays, but every
+// entry in them, the node hierarchy, animations, cameras, lights, skeletons
+// and metadata are borrowed from the source. A stage that needs to modify an
+// entry asks for it through mutable*(), which deep-copies just that entry on
+// first use. Everything that is never touched is never copied.
+//
+// A stage may replace a whole pointer array (e.g. the embedded textures) once
+// every entry in it has been made mutable; entries it adds are owned by the view.
+//
+// The source must outlive the view and must not change while the view exists.
+// Several views over one source may be used concurrently.
+class CowScene
+{
+public:
+    explicit CowScene( const aiScene* source );
+    ~CowScene();
+
+    CowScene( const CowScene& )            = delete;
+    CowScene& operator=( const CowScene& ) = delete;
+
+    // The view as a plain scene. Only entries returned by the accessors below
+    // may be modified through it.
+    aiScene*       get()       { return m_scene; }
+    const aiScene* get() const { return m_scene; }
+
+    // Deep copies, made on first call.
+    aiMesh*     mutableMesh( unsigned int i );
+    aiMaterial* mutableMaterial( unsigned int i );
+    aiTexture*  mutableTexture( unsigned int i );
+
+    // Shallow copy of mesh i: its scalar fields (name, material index, ...)
+    // may be changed, its vertex / face / bone data stays shared and read-only.
+    aiMesh* meshHeader( unsigned int i );
+
+    // Make mesh i a header over the data of mesh `from` (identical geometry,
+    // see findMeshTwins), keeping its own name and material index. Mesh i's
+    // previous copy, if any, is freed. Call again after mesh `from` changes.
+    void shareMesh( unsigned int i, unsigned int from );
+
+    // Rebuild the material list: material i moves to remap[i], or is dropped
+    // when remap[i] == ~0u. Mesh material indices follow, through mesh headers
+    // where the mesh itself is still shared.
+    void remapMaterials( const std::vector<unsigned int>& remap, unsigned int newCount );
+
+private:
+    enum class Share { Borrowed, Header, Owned };
+
+    static void releaseHeader( aiMesh* header );
+
+    aiScene*           m_scene = nullptr;
+    std::vector<Share> m_meshes;
+    std::vector<Share> m_materials;
+    std::vector<Share> m_textures;
+};
+
+} // namespace lodgen
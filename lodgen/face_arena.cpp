@@ -0,0 +1,157 @@
+#include "face_arena.hpp"
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <mutex>
+#include <unordered_map>
+
+namespace lodgen
+{
+
+// Blocks currently owned by some mesh, keyed by their start (face 0's mIndices).
+// An entry only matches the face array it was made for and its size: should
+// an arena mesh ever be freed unreleased, a reused address alone does not
+// make an unrelated mesh look like an arena mesh.
+struct Arena
+{
+    const aiFace* faces;
+    size_t        indexCount;
+};
+
+static std::mutex                                       s_arenaMutex;
+static std::unordered_map<const unsigned int*, Arena>  s_arenas;
+
+// The registry entry of `mesh`'s faces; call under s_arenaMutex.
+static auto findArena( const aiMesh* mesh )
+{
+    if ( !mesh->mFaces || mesh->mNumFaces == 0 || !mesh->mFaces[0].mIndices )
+        return s_arenas.end();
+    auto it = s_arenas.find( mesh->mFaces[0].mIndices );
+    if ( it == s_arenas.end() || it->second.faces != mesh->mFaces
+         || it->second.indexCount != size_t( mesh->mNumFaces ) * mesh->mFaces[0].mNumIndices )
+        return s_arenas.end();
+    return it;
+}
+
+bool hasFaceArena( const aiMesh* mesh )
+{
+    std::lock_guard lock( s_arenaMutex );
+    return findArena( mesh ) != s_arenas.end();
+}
+
+// Unregister the block of `mesh` if it has one; returns whether it had.
+static bool takeArena( aiMesh* mesh )
+{
+    std::lock_guard lock( s_arenaMutex );
+    auto it = findArena( mesh );
+    if ( it == s_arenas.end() )
+        return false;
+    s_arenas.erase( it );
+    return true;
+}
+
+void releaseFaceArena( aiMesh* mesh )
+{
+    if ( !takeArena( mesh ) )
+        return;
+    for ( unsigned int f = 1; f < mesh->mNumFaces; ++f )
+        mesh->mFaces[f].mIndices = nullptr;
+}
+
+void releaseFaceArenas( const aiScene* scene )
+{
+    if ( !scene )
+        return;
+    for ( unsigned int m = 0; m < scene->mNumMeshes; ++m )
+        if ( scene->mMeshes[m] )
+            releaseFaceArena( scene->mMeshes[m] ); // the scene is being freed
+}
+
+void freeFaces( aiMesh* mesh )
+{
+    releaseFaceArena( mesh );
+    delete[] mesh->mFaces;
+    mesh->mFaces    = nullptr;
+    mesh->mNumFaces = 0;
+}
+
+void setFaces( aiMesh* mesh, std::span<const unsigned int> indices, unsigned int faceSize )
+{
+    assert( faceSize > 0 && indices.size() % faceSize == 0 );
+    freeFaces( mesh );
+
+    const unsigned int faceCount = static_cast<unsigned int>( indices.size() / faceSize );
+    if ( faceCount == 0 )
+        return;
+
+    unsigned int* block = new unsigned int[indices.size()];
+    std::memcpy( block, indices.data(), indices.size_bytes() );
+
+    mesh->mFaces    = new aiFace[faceCount];
+    mesh->mNumFaces = faceCount;
+    for ( unsigned int f = 0; f < faceCount; ++f )
+    {
+        mesh->mFaces[f].mNumIndices = faceSize;
+        mesh->mFaces[f].mIndices    = block + size_t( f ) * faceSize;
+    }
+
+    std::lock_guard lock( s_arenaMutex );
+    s_arenas[block] = { mesh->mFaces, indices.size() };
+}
+
+void setSeparateFaces( aiMesh* mesh, std::span<const unsigned int> indices, unsigned int faceSize )
+{
+    assert( faceSize > 0 && indices.size() % faceSize == 0 );
+    freeFaces( mesh );
+
+    const unsigned int faceCount = static_cast<unsigned int>( indices.size() / faceSize );
+    if ( faceCount == 0 )
+        return;
+
+    mesh->mFaces    = new aiFace[faceCount];
+    mesh->mNumFaces = faceCount;
+    for ( unsigned int f = 0; f < faceCount; ++f )
+    {
+        aiFace& face     = mesh->mFaces[f];
+        face.mNumIndices = faceSize;
+        face.mIndices    = new unsigned int[faceSize];
+        std::copy_n( indices.data() + size_t( f ) * faceSize, faceSize, face.mIndices );
+    }
+}
+
+size_t faceIndexCount( const aiMesh* mesh )
+{
+    if ( hasFaceArena( mesh ) )
+        return size_t( mesh->mNumFaces ) * mesh->mFaces[0].mNumIndices; // uniform size
+
+    size_t count = 0;
+    for ( unsigned int f = 0; f < mesh->mNumFaces; ++f )
+        count += mesh->mFaces[f].mNumIndices;
+    return count;
+}
+
+void copyFaceIndices( const aiMesh* mesh, std::span<unsigned int> out )
+{
+    if ( hasFaceArena( mesh ) )
+    {
+        const unsigned int* block = mesh->mFaces[0].mIndices;
+        std::copy( block, block + size_t( mesh->mNumFaces ) * mesh->mFaces[0].mNumIndices, out.begin() );
+        return;
+    }
+
+    auto it = out.begin();
+    for ( unsigned int f = 0; f < mesh->mNumFaces; ++f )
+    {
+        const aiFace& face = mesh->mFaces[f];
+        it = std::copy( face.mIndices, face.mIndices + face.mNumIndices, it );
+    }
+}
+
+std::vector<unsigned int> faceIndices( const aiMesh* mesh )
+{
+    std::vector<unsigned int> indices( faceIndexCount( mesh ) );
+    copyFaceIndices( mesh, indices );
+    return indices;
+}
+
+} // namespace lodgen
@@ -0,0 +1,49 @@
+#pragma once
+#include <assimp/mesh.h>
+#include <assimp/scene.h>
+#include <span>
+#include <vector>
+
+namespace lodgen
+{
+
+// Contiguous face storage for meshes written by lodgen.
+//
+// assimp gives every aiFace its own `new unsigned int[n]`. Meshes lodgen owns
+// may instead keep all indices in one block: face f points at block + 3f, and
+// the block is registered together with its face array and size so that
+// hasFaceArena can tell such a mesh apart from an imported one.
+//
+// ~aiFace would delete[] each of those interior pointers, so an arena mesh
+// must go through releaseFaceArena (or freeFaces) before assimp destroys it.
+// Only use setFaces on meshes freed through ScenePtr / MutableScenePtr or
+// CowScene, which do; anything else gets setSeparateFaces.
+
+// Replace the faces of `mesh` by faces of `faceSize` indices taken in order
+// from `indices` (size % faceSize == 0), stored in one block.
+void setFaces( aiMesh* mesh, std::span<const unsigned int> indices, unsigned int faceSize );
+
+// The same in assimp's own layout, a new[] per face: safe for any owner.
+void setSeparateFaces( aiMesh* mesh, std::span<const unsigned int> indices, unsigned int faceSize );
+
+// All face indices of `mesh` in order. A single copy for arena meshes.
+std::vector<unsigned int> faceIndices( const aiMesh* mesh );
+
+// The same into a caller buffer of faceIndexCount( mesh ) elements.
+size_t faceIndexCount( const aiMesh* mesh );
+void   copyFaceIndices( const aiMesh* mesh, std::span<unsigned int> out );
+
+// True if the faces of `mesh` live in a lodgen block.
+bool hasFaceArena( const aiMesh* mesh );
+
+// Free the faces of `mesh`, arena or not; leaves mFaces null and mNumFaces 0.
+void freeFaces( aiMesh* mesh );
+
+// Hand the block to face 0 and null the interior pointers, so the usual
+// ~aiMesh frees it correctly. The faces are unusable afterwards.
+void releaseFaceArena( aiMesh* mesh );
+
+// releaseFaceArena for every mesh of a scene about to be freed.
+void releaseFaceArenas( const aiScene* scene );
+
+} // namespace lodgen
@@ -0,0 +1,384 @@
+#include "gltf_compress.hpp"
+#include "gltf_file.hpp"
+#include "stopwatch.hpp"
+#include <meshoptimizer.h>
+#include <algorithm>
+#include <cstring>
+#include <optional>
+#include <string_view>
+#include <vector>
+
+namespace lodgen
+{
+
+static constexpr const char* kExtension = "EXT_meshopt_compression";
+
+bool canCompress( const fs::path& path )
+{
+    return isGltfPath( path );
+}
+
+// ── Classifying buffer views ─────────────────────────────────────────────────
+
+enum class StreamMode
+{
+    None,       // not used by a mesh: stored as is
+    Attributes,
+    Triangles,
+    Indices,
+    Raw,        // conflicting or sparse uses: stored as is
+};
+
+struct ViewUse
+{
+    StreamMode   mode        = StreamMode::None;
+    unsigned int accessors   = 0;     // accessors on the view
+    size_t       accessor    = 0;     // the last of them
+    bool         unitVectors = false; // only ever a mesh's NORMAL / TANGENT
+};
+
+static std::vector<ViewUse> classifyViews( const rj::Document& doc )
+{
+    const rj::Value& accessors = doc["accessors"];
+    std::vector<ViewUse> uses( doc["bufferViews"].Size() );
+
+    auto viewOf = [&]( const rj::Value& owner ) -> ViewUse* {
+        const size_t v = uintMember( owner, "bufferView", ~size_t( 0 ) );
+        return v < uses.size() ? &uses[v] : nullptr;
+    };
+    for ( rj::SizeType a = 0; a < accessors.Size(); ++a )
+    {
+        if ( ViewUse* u = viewOf( accessors[a] ) )
+        {
+            ++u->accessors;
+            u->accessor = a;
+        }
+        if ( accessors[a].HasMember( "sparse" ) )
+            for ( const char* part : { "indices", "values" } )
+                if ( accessors[a]["sparse"].HasMember( part ) )
+                    if ( ViewUse* u = viewOf( accessors[a]["sparse"][part] ) )
+                        u->mode = StreamMode::Raw;
+    }
+
+    std::vector<unsigned int> visits( uses.size(), 0 );
+    auto use = [&]( const rj::Value& ref, StreamMode mode, bool unitVectors ) {
+        if ( !ref.IsUint() || ref.GetUint() >= accessors.Size() )
+            return;
+        ViewUse* u = viewOf( accessors[ref.GetUint()] );
+        if ( !u )
+            return;
+        u->mode        = u->mode == StreamMode::None || u->mode == mode ? mode : StreamMode::Raw;
+        u->unitVectors = visits[u - uses.data()]++ == 0 ? unitVectors : u->unitVectors && unitVectors;
+    };
+
+    if ( !doc.HasMember( "meshes" ) )
+        return uses;
+    for ( const auto& mesh : doc["meshes"].GetArray() )
+    {
+        if ( !mesh.HasMember( "primitives" ) )
+            continue;
+        for ( const auto& prim : mesh["primitives"].GetArray() )
+        {
+            if ( prim.HasMember( "attributes" ) )
+            {
+                const rj::Value& attributes = prim["attributes"];
+                for ( auto it = attributes.MemberBegin(); it != attributes.MemberEnd(); ++it )
+                {
+                    const std::string_view name = it->name.GetString();
+                    use( it->value, StreamMode::Attributes, name == "NORMAL" || name == "TANGENT" );
+                }
+            }
+            // Morph target normals are deltas, not unit vectors.
+            if ( prim.HasMember( "targets" ) )
+                for ( const auto& target : prim["targets"].GetArray() )
+                    for ( auto it = target.MemberBegin(); it != target.MemberEnd(); ++it )
+                        use( it->value, StreamMode::Attributes, false );
+            if ( prim.HasMember( "indices" ) )
+                use( prim["indices"], uintMember( prim, "mode", 4 ) == 4 ? StreamMode::Triangles : StreamMode::Indices,
+                     false );
+        }
+    }
+    return uses;
+}
+
+// ── Encoding ─────────────────────────────────────────────────────────────────
+
+struct EncodedView
+{
+    std::vector<uint8_t> data;
+    size_t               stride = 0;
+    size_t               count  = 0;
+    const char*          mode   = nullptr;
+    const char*          filter = nullptr; // null for NONE
+};
+
+// Quantized unit vectors (snorm8 in 4 bytes, snorm16 in 8) re-encoded with the
+// octahedral filter at the same width; w (a tangent's sign) is kept.
+static std::vector<uint8_t> encodeOctahedral( const uint8_t* data, size_t count, size_t stride, unsigned int components )
+{
+    const float scale = stride == 4 ? 1.0f / 127 : 1.0f / 32767;
+    std::vector<float> v( count * 4, 0.0f );
+    for ( size_t i = 0; i < count; ++i )
+        for ( unsigned int c = 0; c < components; ++c )
+        {
+            int q = 0;
+            if ( stride == 4 )
+                q = static_cast<int8_t>( data[i * stride + c] );
+            else
+            {
+                int16_t s;
+                std::memcpy( &s, data + i * stride + c * 2, 2 );
+                q = s;
+            }
+            v[i * 4 + c] = std::max( q * scale, -1.0f );
+        }
+
+    std::vector<uint8_t> out( count * stride );
+    meshopt_encodeFilterOct( out.data(), count, stride, stride == 4 ? 8 : 16, v.data() );
+    return out;
+}
+
+// The view encoded for EXT_meshopt_compression, or nothing to store it as is.
+static std::optional<EncodedView> encodeView( const GltfFile& f, const rj::Value& view, const ViewUse& use )
+{
+    if ( use.mode == StreamMode::None || use.mode == StreamMode::Raw || uintMember( view, "buffer" ) != 0 )
+        return std::nullopt;
+    const size_t offset = uintMember( view, "byteOffset" );
+    const size_t length = uintMember( view, "byteLength" );
+    if ( length == 0 || offset + length > f.bin.size() )
+        return std::nullopt;
+    const uint8_t* data = f.bin.data() + offset;
+
+    const rj::Value& accessor = f.json["accessors"][static_cast<rj::SizeType>( use.accessor )];
+    const size_t componentType = uintMember( accessor, "componentType" );
+    const size_t elementSize   = componentSize( componentType ) * componentCount( accessor );
+
+    EncodedView out;
+    if ( use.mode == StreamMode::Attributes )
+    {
+        out.stride = uintMember( view, "byteStride", use.accessors == 1 ? elementSize : 0 );
+        if ( out.stride == 0 || out.stride % 4 != 0 || out.stride > 256 || length % out.stride != 0 )
+            return std::nullopt;
+        out.count = length / out.stride;
+        out.mode  = "ATTRIBUTES";
+
+        std::vector<uint8_t> filtered;
+        const bool normalized = accessor.HasMember( "normalized" ) && accessor["normalized"].IsTrue();
+        if ( use.unitVectors && use.accessors == 1 && normalized && uintMember( accessor, "byteOffset" ) == 0 &&
+             ( ( componentType == GltfByte && out.stride == 4 ) || ( componentType == GltfShort && out.stride == 8 ) ) )
+        {
+            filtered   = encodeOctahedral( data, out.count, out.stride, componentCount( accessor ) );
+            data       = filtered.data();
+            out.filter = "OCTAHEDRAL";
+        }
+
+        // Version 0: the only vertex format EXT_meshopt_compression allows.
+        out.data.resize( meshopt_encodeVertexBufferBound( out.count, out.stride ) );
+        out.data.resize( meshopt_encodeVertexBufferLevel(
+            out.data.data(), out.data.size(), data, out.count, out.stride, 2, 0 ) );
+    }
+    else
+    {
+        const size_t indexSize = componentSize( componentType );
+        out.count  = uintMember( accessor, "count" );
+        out.stride = indexSize;
+        if ( use.accessors != 1 || uintMember( accessor, "byteOffset" ) != 0 || view.HasMember( "byteStride" ) ||
+             ( componentType != GltfUnsignedShort && componentType != GltfUnsignedInt ) ||
+             out.count * indexSize != length )
+            return std::nullopt;
+
+        std::vector<unsigned int> indices( out.count );
+        for ( size_t i = 0; i < out.count; ++i )
+        {
+            if ( indexSize == 2 )
+            {
+                uint16_t s;
+                std::memcpy( &s, data + i * 2, 2 );
+                indices[i] = s;
+            }
+            else
+                std::memcpy( &indices[i], data + i * 4, 4 );
+        }
+        const size_t vertexCount = *std::max_element( indices.begin(), indices.end() ) + size_t( 1 );
+
+        if ( use.mode == StreamMode::Triangles && out.count % 3 == 0 )
+        {
+            out.mode = "TRIANGLES";
+            out.data.resize( meshopt_encodeIndexBufferBound( out.count, vertexCount ) );
+            out.data.resize( meshopt_encodeIndexBuffer( out.data.data(), out.data.size(), indices.data(), out.count ) );
+        }
+        else
+        {
+            out.mode = "INDICES";
+            out.data.resize( meshopt_encodeIndexSequenceBound( out.count, vertexCount ) );
+            out.data.resize( meshopt_encodeIndexSequence( out.data.data(), out.data.size(), indices.data(), out.count ) );
+        }
+    }
+
+    if ( out.data.empty() )
+        return std::nullopt;
+    return out;
+}
+
+static void setUint( rj::Value& object, const char* name, uint64_t value, rj::Document::AllocatorType& alloc )
+{
+    if ( object.HasMember( name ) )
+        object[name].SetUint64( value );
+    else
+        object.AddMember( rj::StringRef( name ), value, alloc );
+}
+
+Result<CompressInfo> compressGltf( const fs::path& path )
+{
+    auto file = readGltf( path );
+    if ( !file )
+        return std::unexpected( file.error() );
+    GltfFile& f = *file;
+    rj::Document& doc = f.json;
+    auto& alloc = doc.GetAllocator();
+
+    CompressInfo info;
+    if ( !doc.HasMember( "bufferViews" ) || !doc.HasMember( "accessors" ) || !doc.HasMember( "buffers" ) )
+        return info;
+    if ( doc["buffers"].Size() != 1 )
+        return gltfError( "Compress", path, "only files with a single buffer are supported" );
+
+    // Encoded streams and views stored as is share buffer 0; encoded views
+    // point at buffer 1, which only reserves room for the decoded data.
+    const std::vector<ViewUse> uses = classifyViews( doc );
+    rj::Value& views = doc["bufferViews"];
+    std::vector<uint8_t> bin;
+    uint64_t fallbackSize = 0;
+    for ( rj::SizeType v = 0; v < views.Size(); ++v )
+    {
+        rj::Value& view = views[v];
+        const size_t length = uintMember( view, "byteLength" );
+        bin.resize( ( bin.size() + 3 ) & ~size_t( 3 ), 0 );
+
+        auto encoded = encodeView( f, view, uses[v] );
+        if ( !encoded )
+        {
+            const size_t offset = uintMember( view, "byteOffset" );
+            if ( offset + length <= f.bin.size() )
+                bin.insert( bin.end(), f.bin.begin() + offset, f.bin.begin() + offset + length );
+            else
+                bin.resize( bin.size() + length, 0 );
+            setUint( view, "byteOffset", bin.size() - length, alloc );
+            continue;
+        }
+
+        rj::Value ext( rj::kObjectType );
+        ext.AddMember( "buffer", 0u, alloc );
+        ext.AddMember( "byteOffset", uint64_t( bin.size() ), alloc );
+        ext.AddMember( "byteLength", uint64_t( encoded->data.size() ), alloc );
+        ext.AddMember( "byteStride", uint64_t( encoded->stride ), alloc );
+        ext.AddMember( "count", uint64_t( encoded->count ), alloc );
+        ext.AddMember( "mode", rj::StringRef( encoded->mode ), alloc );
+        if ( encoded->filter )
+            ext.AddMember( "filter", rj::StringRef( encoded->filter ), alloc );
+        bin.insert( bin.end(), encoded->data.begin(), encoded->data.end() );
+
+        if ( !view.HasMember( "extensions" ) )
+            view.AddMember( "extensions", rj::Value( rj::kObjectType ), alloc );
+        view["extensions"].AddMember( rj::StringRef( kExtension ), ext, alloc );
+        setUint( view, "buffer", 1, alloc );
+        setUint( view, "byteOffset", fallbackSize, alloc );
+        fallbackSize = ( fallbackSize + length + 3 ) & ~uint64_t( 3 );
+
+        info.rawBytes        += length;
+        info.compressedBytes += encoded->data.size();
+        ++info.streams;
+    }
+
+    if ( info.streams == 0 )
+        return info;
+
+    f.bin = std::move( bin );
+    setUint( doc["buffers"][0], "byteLength", f.bin.size(), alloc );
+
+    rj::Value fallbackExt( rj::kObjectType ), extensions( rj::kObjectType ), fallback( rj::kObjectType );
+    fallbackExt.AddMember( "fallback", true, alloc );
+    extensions.AddMember( rj::StringRef( kExtension ), fallbackExt, alloc );
+    fallback.AddMember( "byteLength", fallbackSize, alloc );
+    fallback.AddMember( "extensions", extensions, alloc );
+    doc["buffers"].PushBack( fallback, alloc );
+    requireExtension( doc, kExtension );
+
+    if ( auto r = writeGltf( f, path ); !r )
+        return std::unexpected( r.error() );
+    return info;
+}
+
+// ── Decoding ─────────────────────────────────────────────────────────────────
+
+Result<DecodeBenchmark> benchmarkDecode( const fs::path& path, unsigned int iterations )
+{
+    auto file = readGltf( path );
+    if ( !file )
+        return std::unexpected( file.error() );
+    const GltfFile& f = *file;
+
+    struct Stream
+    {
+        const uint8_t*   data;
+        size_t           size, count, stride;
+        std::string_view mode, filter;
+    };
+    std::vector<Stream> streams;
+    size_t largest = 0;
+    if ( f.json.HasMember( "bufferViews" ) )
+        for ( const auto& view : f.json["bufferViews"].GetArray() )
+        {
+            if ( !view.HasMember( "extensions" ) || !view["extensions"].HasMember( kExtension ) )
+                continue;
+            const rj::Value& ext = view["extensions"][kExtension];
+            Stream s;
+            const size_t offset = uintMember( ext, "byteOffset" );
+            s.size   = uintMember( ext, "byteLength" );
+            s.count  = uintMember( ext, "count" );
+            s.stride = uintMember( ext, "byteStride" );
+            s.mode   = ext.HasMember( "mode" ) && ext["mode"].IsString() ? ext["mode"].GetString() : "";
+            s.filter = ext.HasMember( "filter" ) && ext["filter"].IsString() ? ext["filter"].GetString() : "NONE";
+            if ( uintMember( ext, "buffer" ) != 0 || offset + s.size > f.bin.size() )
+                return gltfError( "Decode", path, "compressed view outside buffer 0" );
+            s.data = f.bin.data() + offset;
+            largest = std::max( largest, s.count * s.stride );
+            streams.push_back( s );
+        }
+
+    DecodeBenchmark bench;
+    bench.streams    = static_cast<unsigned int>( streams.size() );
+    bench.iterations = std::max( iterations, 1u );
+    for ( const Stream& s : streams )
+    {
+        bench.decodedBytes    += s.count * s.stride;
+        bench.compressedBytes += s.size;
+    }
+
+    std::vector<uint8_t> target( largest );
+    Stopwatch watch;
+    for ( unsigned int it = 0; it < bench.iterations; ++it )
+        for ( const Stream& s : streams )
+        {
+            int rc = -1;
+            if ( s.mode == "ATTRIBUTES" )
+                rc = meshopt_decodeVertexBuffer( target.data(), s.count, s.stride, s.data, s.size );
+            else if ( s.mode == "TRIANGLES" )
+                rc = meshopt_decodeIndexBuffer( target.data(), s.count, s.stride, s.data, s.size );
+            else if ( s.mode == "INDICES" )
+                rc = meshopt_decodeIndexSequence( target.data(), s.count, s.stride, s.data, s.size );
+            if ( rc != 0 )
+                return gltfError( "Decode", path, "invalid " + std::string( s.mode ) + " stream" );
+
+            if ( s.filter == "OCTAHEDRAL" )
+                meshopt_decodeFilterOct( target.data(), s.count, s.stride );
+            else if ( s.filter == "QUATERNION" )
+                meshopt_decodeFilterQuat( target.data(), s.count, s.stride );
+            else if ( s.filter == "EXPONENTIAL" )
+                meshopt_decodeFilterExp( target.data(), s.count, s.stride );
+        }
+    bench.seconds = watch.elapsed();
+    return bench;
+}
+
+} // namespace lodgen
@@ -0,0 +1,48 @@
+#pragma once
+#include "types.hpp"
+#include <cstdint>
+
+namespace lodgen
+{
+
+// meshoptimizer compression of exported glTF files (EXT_meshopt_compression).
+//
+// compressGltf rewrites the file's buffer views with meshoptimizer's codecs:
+//   vertex attributes    meshopt_encodeVertexBuffer (format version 0, as the
+//                        extension requires); quantized normals and tangents
+//                        (snorm8 / snorm16, see gltf_quantize.hpp) also go
+//                        through the octahedral filter
+//   triangle indices     meshopt_encodeIndexBuffer
+//   other indices        meshopt_encodeIndexSequence
+// Everything else (images, animation data) is stored as is. Encoded views
+// point at a fallback buffer without data, so the extension is required.
+// The codecs work best on quantized, fetch-ordered data: run it after
+// quantizeGltf.
+
+struct CompressInfo
+{
+    uint64_t     rawBytes        = 0; // encoded buffer views, before
+    uint64_t     compressedBytes = 0; // and after
+    unsigned int streams         = 0; // buffer views encoded
+};
+
+// True for outputs compressGltf can rewrite (.gltf with an external buffer, .glb).
+bool canCompress( const fs::path& path );
+
+// Compress the buffer views of the glTF file at `path` in place.
+Result<CompressInfo> compressGltf( const fs::path& path );
+
+struct DecodeBenchmark
+{
+    uint64_t     decodedBytes    = 0; // per iteration
+    uint64_t     compressedBytes = 0; // per iteration
+    unsigned int streams         = 0;
+    unsigned int iterations      = 0;
+    double       seconds         = 0; // all iterations; decoding and filters only, no I/O
+};
+
+// Decode every EXT_meshopt_compression buffer view of the file at `path`
+// `iterations` times, as a loader would, and time it.
+Result<DecodeBenchmark> benchmarkDecode( const fs::path& path, unsigned int iterations = 10 );
+
+} // namespace lodgen
@@ -0,0 +1,392 @@
+#include "gltf_file.hpp"
+#include <rapidjson/stringbuffer.h>
+#include <rapidjson/writer.h>
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+namespace lodgen
+{
+
+static constexpr uint32_t kGlbMagic     = 0x46546C67; // "glTF"
+static constexpr uint32_t kGlbChunkJson = 0x4E4F534A;
+static constexpr uint32_t kGlbChunkBin  = 0x004E4942;
+
+static std::string lowerExtension( const fs::path& path )
+{
+    std::string ext = path.extension().string();
+    std::transform( ext.begin(), ext.end(), ext.begin(), []( unsigned char c ) { return std::tolower( c ); } );
+    return ext;
+}
+
+bool isGltfPath( const fs::path& path )
+{
+    const std::string ext = lowerExtension( path );
+    return ext == ".gltf" || ext == ".glb";
+}
+
+std::unexpected<Error> gltfError( const char* pass, const fs::path& path, const std::string& what )
+{
+    return std::unexpected( Error{ ErrorCode::ExportFailed, std::string( pass ) + " " + path.string() + ": " + what } );
+}
+
+// ── Container ────────────────────────────────────────────────────────────────
+
+static bool readBytes( const fs::path& path, std::vector<uint8_t>& out )
+{
+    std::ifstream in( path, std::ios::binary );
+    if ( !in )
+        return false;
+    out.assign( std::istreambuf_iterator<char>( in ), std::istreambuf_iterator<char>() );
+    return true;
+}
+
+static bool writeBytes( const fs::path& path, const void* data, size_t size )
+{
+    std::ofstream out( path, std::ios::binary );
+    out.write( static_cast<const char*>( data ), size );
+    return static_cast<bool>( out.flush() );
+}
+
+Result<GltfFile> readGltf( const fs::path& path )
+{
+    GltfFile f;
+    std::vector<uint8_t> bytes;
+    if ( !readBytes( path, bytes ) )
+        return gltfError( "Read", path, "cannot read the file" );
+
+    f.glb = lowerExtension( path ) == ".glb";
+    std::string_view text( reinterpret_cast<const char*>( bytes.data() ), bytes.size() );
+    if ( f.glb )
+    {
+        auto u32 = [&]( size_t at ) {
+            uint32_t v = 0;
+            if ( at + 4 <= bytes.size() )
+                std::memcpy( &v, bytes.data() + at, 4 );
+            return v;
+        };
+        if ( u32( 0 ) != kGlbMagic || u32( 4 ) != 2 )
+            return gltfError( "Read", path, "not a glTF 2.0 binary" );
+
+        text = {};
+        for ( size_t at = 12; at + 8 <= bytes.size(); )
+        {
+            const size_t length = u32( at );
+            const uint32_t type = u32( at + 4 );
+            if ( at + 8 + length > bytes.size() )
+                return gltfError( "Read", path, "truncated chunk" );
+            const uint8_t* data = bytes.data() + at + 8;
+            if ( type == kGlbChunkJson )
+                text = std::string_view( reinterpret_cast<const char*>( data ), length );
+            else if ( type == kGlbChunkBin )
+                f.bin.assign( data, data + length );
+            at += 8 + length;
+        }
+    }
+
+    f.json.Parse( text.data(), text.size() );
+    if ( f.json.HasParseError() || !f.json.IsObject() )
+        return gltfError( "Read", path, "invalid JSON" );
+
+    if ( f.json.HasMember( "buffers" ) )
+    {
+        const rj::Value& buffers = f.json["buffers"];
+        if ( !buffers.IsArray() )
+            return gltfError( "Read", path, "invalid buffers" );
+        for ( rj::SizeType b = 1; b < buffers.Size(); ++b )
+            if ( buffers[b].HasMember( "uri" ) )
+                return gltfError( "Read", path, "only the first buffer may hold data" );
+        if ( !f.glb && buffers.Size() > 0 )
+        {
+            if ( !buffers[0].HasMember( "uri" ) || !buffers[0]["uri"].IsString() )
+                return gltfError( "Read", path, "buffer without uri" );
+            const std::string uri = buffers[0]["uri"].GetString();
+            if ( uri.starts_with( "data:" ) )
+                return gltfError( "Read", path, "embedded (data: URI) buffers are not supported" );
+            f.binPath = path.parent_path() / uri;
+            if ( !readBytes( f.binPath, f.bin ) )
+                return gltfError( "Read", path, "cannot read " + f.binPath.string() );
+        }
+    }
+    return f;
+}
+
+VoidResult writeGltf( const GltfFile& f, const fs::path& path )
+{
+    rj::StringBuffer text;
+    rj::Writer<rj::StringBuffer> writer( text );
+    f.json.Accept( writer );
+
+    if ( !f.glb )
+    {
+        if ( !writeBytes( path, text.GetString(), text.GetSize() ) ||
+             ( !f.binPath.empty() && !writeBytes( f.binPath, f.bin.data(), f.bin.size() ) ) )
+            return gltfError( "Write", path, "cannot write the file" );
+        return {};
+    }
+
+    // Chunks are 4-byte aligned: JSON padded with spaces, BIN with zeros.
+    std::string json( text.GetString(), text.GetSize() );
+    json.resize( ( json.size() + 3 ) & ~size_t( 3 ), ' ' );
+    std::vector<uint8_t> bin = f.bin;
+    bin.resize( ( bin.size() + 3 ) & ~size_t( 3 ), 0 );
+
+    std::vector<uint8_t> out;
+    auto put32 = [&]( uint32_t v ) {
+        const auto* p = reinterpret_cast<const uint8_t*>( &v );
+        out.insert( out.end(), p, p + 4 );
+    };
+    const size_t total = 12 + 8 + json.size() + ( bin.empty() ? 0 : 8 + bin.size() );
+    put32( kGlbMagic );
+    put32( 2 );
+    put32( static_cast<uint32_t>( total ) );
+    put32( static_cast<uint32_t>( json.size() ) );
+    put32( kGlbChunkJson );
+    out.insert( out.end(), json.begin(), json.end() );
+    if ( !bin.empty() )
+    {
+        put32( static_cast<uint32_t>( bin.size() ) );
+        put32( kGlbChunkBin );
+        out.insert( out.end(), bin.begin(), bin.end() );
+    }
+    if ( !writeBytes( path, out.data(), out.size() ) )
+        return gltfError( "Write", path, "cannot write the file" );
+    return {};
+}
+
+// ── JSON helpers ─────────────────────────────────────────────────────────────
+
+size_t uintMember( const rj::Value& v, const char* name, size_t fallback )
+{
+    return v.HasMember( name ) && v[name].IsUint64() ? static_cast<size_t>( v[name].GetUint64() ) : fallback;
+}
+
+unsigned int componentCount( const rj::Value& accessor )
+{
+    if ( !accessor.HasMember( "type" ) || !accessor["type"].IsString() )
+        return 0;
+    const std::string_view type = accessor["type"].GetString();
+    if ( type == "SCALAR" ) return 1;
+    if ( type == "VEC2" )   return 2;
+    if ( type == "VEC3" )   return 3;
+    if ( type == "VEC4" )   return 4;
+    return 0;
+}
+
+unsigned int componentSize( size_t componentType )
+{
+    switch ( componentType )
+    {
+    case GltfByte: case GltfUnsignedByte:   return 1;
+    case GltfShort: case GltfUnsignedShort: return 2;
+    case GltfUnsignedInt: case GltfFloat:   return 4;
+    default:                                return 0;
+    }
+}
+
+void requireExtension( rj::Document& doc, const char* name )
+{
+    auto& alloc = doc.GetAllocator();
+    for ( const char* list : { "extensionsUsed", "extensionsRequired" } )
+    {
+        if ( !doc.HasMember( list ) )
+            doc.AddMember( rj::StringRef( list ), rj::Value( rj::kArrayType ), alloc );
+        rj::Value& names = doc[list];
+        bool present = false;
+        for ( const auto& n : names.GetArray() )
+            present = present || ( n.IsString() && std::string_view( n.GetString() ) == name );
+        if ( !present )
+            names.PushBack( rj::StringRef( name ), alloc );
+    }
+}
+
+// ── Adding data ──────────────────────────────────────────────────────────────
+
+unsigned int addAccessor( GltfFile& f, PendingViews& views, std::vector<uint8_t> data, size_t stride,
+                          int componentType, const char* type, size_t count, unsigned int flags )
+{
+    auto& alloc = f.json.GetAllocator();
+    if ( !f.json.HasMember( "bufferViews" ) )
+        f.json.AddMember( "bufferViews", rj::Value( rj::kArrayType ), alloc );
+    if ( !f.json.HasMember( "accessors" ) )
+        f.json.AddMember( "accessors", rj::Value( rj::kArrayType ), alloc );
+
+    rj::Value view( rj::kObjectType );
+    view.AddMember( "buffer", 0u, alloc );
+    view.AddMember( "byteLength", uint64_t( data.size() ), alloc );
+    if ( flags & GltfVertexData )
+    {
+        view.AddMember( "byteStride", uint64_t( stride ), alloc );
+        view.AddMember( "target", 34962u, alloc ); // ARRAY_BUFFER
+    }
+    f.json["bufferViews"].PushBack( view, alloc );
+    views.data.push_back( std::move( data ) );
+
+    rj::Value accessor( rj::kObjectType );
+    accessor.AddMember( "bufferView", f.json["bufferViews"].Size() - 1, alloc );
+    accessor.AddMember( "componentType", componentType, alloc );
+    if ( flags & GltfNormalized )
+        accessor.AddMember( "normalized", true, alloc );
+    accessor.AddMember( "count", uint64_t( count ), alloc );
+    accessor.AddMember( "type", rj::StringRef( type ), alloc );
+    f.json["accessors"].PushBack( accessor, alloc );
+    return f.json["accessors"].Size() - 1;
+}
+
+// ── Repacking ────────────────────────────────────────────────────────────────
+
+// Every place the core spec or EXT_mesh_gpu_instancing keeps an accessor index.
+template <typename Fn>
+static void forEachAccessorRef( rj::Document& doc, Fn&& fn )
+{
+    auto visit = [&]( rj::Value& v ) {
+        if ( v.IsUint() )
+            fn( v );
+    };
+    // GetObject() does not compile with RAPIDJSON_NOMEMBERITERATORCLASS.
+    auto visitMembers = [&]( rj::Value& object ) {
+        for ( auto it = object.MemberBegin(); it != object.MemberEnd(); ++it )
+            visit( it->value );
+    };
+    if ( doc.HasMember( "meshes" ) )
+        for ( auto& mesh : doc["meshes"].GetArray() )
+        {
+            if ( !mesh.HasMember( "primitives" ) )
+                continue;
+            for ( auto& prim : mesh["primitives"].GetArray() )
+            {
+                if ( prim.HasMember( "attributes" ) )
+                    visitMembers( prim["attributes"] );
+                if ( prim.HasMember( "indices" ) )
+                    visit( prim["indices"] );
+                if ( prim.HasMember( "targets" ) )
+                    for ( auto& target : prim["targets"].GetArray() )
+                        visitMembers( target );
+            }
+        }
+    if ( doc.HasMember( "nodes" ) )
+        for ( auto& node : doc["nodes"].GetArray() )
+            if ( node.HasMember( "extensions" ) && node["extensions"].HasMember( "EXT_mesh_gpu_instancing" ) &&
+                 node["extensions"]["EXT_mesh_gpu_instancing"].HasMember( "attributes" ) )
+                visitMembers( node["extensions"]["EXT_mesh_gpu_instancing"]["attributes"] );
+    if ( doc.HasMember( "skins" ) )
+        for ( auto& skin : doc["skins"].GetArray() )
+            if ( skin.HasMember( "inverseBindMatrices" ) )
+                visit( skin["inverseBindMatrices"] );
+    if ( doc.HasMember( "animations" ) )
+        for ( auto& anim : doc["animations"].GetArray() )
+            if ( anim.HasMember( "samplers" ) )
+                for ( auto& s : anim["samplers"].GetArray() )
+                {
+                    if ( s.HasMember( "input" ) )  visit( s["input"] );
+                    if ( s.HasMember( "output" ) ) visit( s["output"] );
+                }
+}
+
+// Every place the core spec keeps a buffer view index.
+template <typename Fn>
+static void forEachViewRef( rj::Document& doc, Fn&& fn )
+{
+    auto visit = [&]( rj::Value& owner ) {
+        if ( owner.IsObject() && owner.HasMember( "bufferView" ) && owner["bufferView"].IsUint() )
+            fn( owner["bufferView"] );
+    };
+    if ( doc.HasMember( "accessors" ) )
+        for ( auto& a : doc["accessors"].GetArray() )
+        {
+            visit( a );
+            if ( a.HasMember( "sparse" ) )
+            {
+                if ( a["sparse"].HasMember( "indices" ) ) visit( a["sparse"]["indices"] );
+                if ( a["sparse"].HasMember( "values" ) )  visit( a["sparse"]["values"] );
+            }
+        }
+    if ( doc.HasMember( "images" ) )
+        for ( auto& image : doc["images"].GetArray() )
+            visit( image );
+}
+
+void repackGltf( GltfFile& f, const std::vector<bool>& dropped, const PendingViews& views )
+{
+    rj::Document& doc = f.json;
+    auto& alloc = doc.GetAllocator();
+
+    // ── accessors ──
+    const size_t accessorCount = doc["accessors"].Size();
+    std::vector<bool> keep( accessorCount, true );
+    for ( size_t a = 0; a < dropped.size() && a < accessorCount; ++a )
+        keep[a] = !dropped[a];
+    forEachAccessorRef( doc, [&]( rj::Value& v ) { if ( v.GetUint() < accessorCount ) keep[v.GetUint()] = true; } );
+
+    // Views referenced by the accessors about to go.
+    std::vector<bool> droppable( doc["bufferViews"].Size(), false );
+    for ( size_t a = 0; a < accessorCount; ++a )
+        if ( !keep[a] )
+        {
+            const size_t v = uintMember( doc["accessors"][a], "bufferView", ~size_t( 0 ) );
+            if ( v < droppable.size() )
+                droppable[v] = true;
+        }
+
+    std::vector<unsigned int> accessorIndex( accessorCount, ~0u );
+    rj::Value accessors( rj::kArrayType );
+    for ( size_t a = 0; a < accessorCount; ++a )
+        if ( keep[a] )
+        {
+            accessorIndex[a] = accessors.Size();
+            accessors.PushBack( doc["accessors"][a], alloc ); // moves
+        }
+    doc["accessors"] = accessors;
+    forEachAccessorRef( doc, [&]( rj::Value& v ) {
+        if ( v.GetUint() < accessorCount ) v.SetUint( accessorIndex[v.GetUint()] );
+    } );
+
+    // ── buffer views ──
+    const size_t viewCount = doc["bufferViews"].Size();
+    std::vector<bool> used( viewCount, false );
+    for ( size_t v = 0; v < viewCount; ++v )
+        used[v] = !droppable[v];
+    forEachViewRef( doc, [&]( rj::Value& v ) { if ( v.GetUint() < viewCount ) used[v.GetUint()] = true; } );
+
+    std::vector<uint8_t> bin;
+    std::vector<unsigned int> viewIndex( viewCount, ~0u );
+    rj::Value bufferViews( rj::kArrayType );
+    for ( size_t v = 0; v < viewCount; ++v )
+    {
+        if ( !used[v] )
+            continue;
+        rj::Value& view = doc["bufferViews"][v];
+        const size_t length = uintMember( view, "byteLength" );
+        const uint8_t* source = nullptr;
+        if ( v >= views.firstView && v - views.firstView < views.data.size() )
+            source = views.data[v - views.firstView].data();
+        else if ( uintMember( view, "byteOffset" ) + length <= f.bin.size() )
+            source = f.bin.data() + uintMember( view, "byteOffset" );
+
+        bin.resize( ( bin.size() + 3 ) & ~size_t( 3 ), 0 );
+        const size_t offset = bin.size();
+        if ( source )
+            bin.insert( bin.end(), source, source + length );
+        else
+            bin.resize( offset + length, 0 );
+
+        if ( view.HasMember( "byteOffset" ) )
+            view["byteOffset"].SetUint64( offset );
+        else
+            view.AddMember( "byteOffset", uint64_t( offset ), alloc );
+        viewIndex[v] = bufferViews.Size();
+        bufferViews.PushBack( view, alloc ); // moves
+    }
+    doc["bufferViews"] = bufferViews;
+    forEachViewRef( doc, [&]( rj::Value& v ) {
+        if ( v.GetUint() < viewCount ) v.SetUint( viewIndex[v.GetUint()] );
+    } );
+
+    f.bin = std::move( bin );
+    if ( doc.HasMember( "buffers" ) && doc["buffers"].Size() == 1 )
+        doc["buffers"][0]["byteLength"].SetUint64( f.bin.size() );
+}
+
+} // namespace lodgen
@@ -0,0 +1,87 @@
+#pragma once
+#include "types.hpp"
+#include <rapidjson/document.h>
+#include <cstdint>
+#include <vector>
+
+// glTF / GLB container access shared by the passes that rewrite exported glTF
+// files (gltf_quantize, gltf_compress, gltf_instancing). Internal: rapidjson comes from
+// assimp's contrib directory and must be configured like assimp's.
+
+namespace lodgen
+{
+
+namespace rj = rapidjson;
+
+enum GltfComponentType : int
+{
+    GltfByte          = 5120,
+    GltfUnsignedByte  = 5121,
+    GltfShort         = 5122,
+    GltfUnsignedShort = 5123,
+    GltfUnsignedInt   = 5125,
+    GltfFloat         = 5126,
+};
+
+struct GltfFile
+{
+    rj::Document         json;
+    std::vector<uint8_t> bin;     // buffer 0; other buffers carry no data
+    fs::path             binPath; // .gltf: the file holding buffer 0
+    bool                 glb = false;
+};
+
+// .gltf or .glb, by extension.
+bool isGltfPath( const fs::path& path );
+
+// A .glb, or a .gltf whose buffer 0 is an external file. Further buffers are
+// accepted only without a uri (e.g. EXT_meshopt_compression fallbacks).
+Result<GltfFile> readGltf( const fs::path& path );
+
+// Write `f` to `path` (and buffer 0 to f.binPath for a .gltf).
+VoidResult writeGltf( const GltfFile& f, const fs::path& path );
+
+// Error{ ExportFailed } naming the pass and the file.
+std::unexpected<Error> gltfError( const char* pass, const fs::path& path, const std::string& what );
+
+// Unsigned member `name` of `v`, or `fallback`.
+size_t uintMember( const rj::Value& v, const char* name, size_t fallback = 0 );
+
+// Components per element of an accessor's "type" (SCALAR..VEC4), 0 otherwise.
+unsigned int componentCount( const rj::Value& accessor );
+
+// Bytes per component of a GltfComponentType, 0 if unknown.
+unsigned int componentSize( size_t componentType );
+
+// Add `name` to extensionsUsed and extensionsRequired.
+void requireExtension( rj::Document& doc, const char* name );
+
+// ── Adding data ──
+
+// Buffer views added by a pass: their bytes wait in `data` (view index -
+// firstView) until repackGltf lays out buffer 0.
+struct PendingViews
+{
+    size_t                            firstView = 0;
+    std::vector<std::vector<uint8_t>> data;
+};
+
+enum GltfAccessorFlags : unsigned int
+{
+    GltfPlain      = 0,
+    GltfNormalized = 1, // integer components read as [0, 1] / [-1, 1]
+    GltfVertexData = 2, // strided ARRAY_BUFFER view
+};
+
+// Append an accessor of `count` elements over a new buffer view holding
+// `data`; returns the accessor index.
+unsigned int addAccessor( GltfFile& f, PendingViews& views, std::vector<uint8_t> data, size_t stride,
+                          int componentType, const char* type, size_t count, unsigned int flags );
+
+// Drop the accessors flagged in `dropped` that nothing references any more,
+// then the buffer views only they used, and rebuild buffer 0 from the views
+// left and the pending ones. Accessor references are the core spec's and
+// EXT_mesh_gpu_instancing's.
+void repackGltf( GltfFile& f, const std::vector<bool>& dropped, const PendingViews& views );
+
+} // namespace lodgen
@@ -0,0 +1,571 @@
+#include "gltf_instancing.hpp"
+#include "build_cache.hpp"
+#include "gltf_file.hpp"
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <map>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace lodgen
+{
+
+static constexpr const char* kExtension = "EXT_mesh_gpu_instancing";
+
+bool canInstance( const fs::path& path )
+{
+    return isGltfPath( path );
+}
+
+// ── Identical meshes ─────────────────────────────────────────────────────────
+
+// Elements of a plain (not sparse) accessor in buffer 0; data is null otherwise.
+struct AccessorData
+{
+    const uint8_t* data          = nullptr;
+    size_t         count         = 0;
+    size_t         elementSize   = 0;
+    size_t         stride        = 0;
+    size_t         componentType = 0;
+    unsigned int   components    = 0;
+    bool           normalized    = false;
+};
+
+static AccessorData accessorData( const GltfFile& f, size_t index )
+{
+    const rj::Value& accessors = f.json["accessors"];
+    const rj::Value& views     = f.json["bufferViews"];
+    if ( index >= accessors.Size() )
+        return {};
+    const rj::Value& accessor = accessors[index];
+    if ( accessor.HasMember( "sparse" ) || !accessor.HasMember( "bufferView" ) )
+        return {};
+    const size_t viewIndex = uintMember( accessor, "bufferView" );
+    if ( viewIndex >= views.Size() || uintMember( views[viewIndex], "buffer" ) != 0 )
+        return {};
+
+    AccessorData a;
+    a.componentType = uintMember( accessor, "componentType" );
+    a.components    = componentCount( accessor );
+    a.elementSize   = a.components * componentSize( a.componentType );
+    a.count         = uintMember( accessor, "count" );
+    a.normalized    = accessor.HasMember( "normalized" ) && accessor["normalized"].IsBool() &&
+                      accessor["normalized"].GetBool();
+    a.stride        = uintMember( views[viewIndex], "byteStride", a.elementSize );
+    const size_t offset = uintMember( views[viewIndex], "byteOffset" ) + uintMember( accessor, "byteOffset" );
+    if ( a.elementSize == 0 || a.count == 0 || offset + a.stride * ( a.count - 1 ) + a.elementSize > f.bin.size() )
+        return {};
+    a.data = f.bin.data() + offset;
+    return a;
+}
+
+static uint64_t accessorHash( const AccessorData& a )
+{
+    ContentHash h;
+    h.add( a.componentType );
+    h.add( a.components );
+    h.add( a.count );
+    h.add( a.normalized );
+    for ( size_t i = 0; i < a.count; ++i )
+        h.add( a.data + i * a.stride, a.elementSize );
+    return h.value();
+}
+
+static bool sameData( const AccessorData& a, const AccessorData& b )
+{
+    if ( a.componentType != b.componentType || a.components != b.components || a.count != b.count ||
+         a.normalized != b.normalized )
+        return false;
+    for ( size_t i = 0; i < a.count; ++i )
+        if ( std::memcmp( a.data + i * a.stride, b.data + i * b.stride, a.elementSize ) != 0 )
+            return false;
+    return true;
+}
+
+// What two meshes must share to be merged: modes, materials and attribute
+// names of their primitives (`layout`), and the data of their accessors.
+struct MeshShape
+{
+    std::string         layout;
+    std::vector<size_t> accessors; // in layout order
+    bool                valid = false;
+};
+
+static MeshShape meshShape( const rj::Value& mesh )
+{
+    MeshShape s;
+    if ( !mesh.HasMember( "primitives" ) || !mesh["primitives"].IsArray() || mesh.HasMember( "weights" ) ||
+         mesh.HasMember( "extensions" ) )
+        return s;
+    for ( const auto& prim : mesh["primitives"].GetArray() )
+    {
+        if ( !prim.HasMember( "attributes" ) || prim.HasMember( "targets" ) || prim.HasMember( "extensions" ) )
+            return {};
+        s.layout += std::to_string( uintMember( prim, "mode", 4 ) ) + ' ' +
+                    std::to_string( uintMember( prim, "material", ~size_t( 0 ) ) ) + ' ';
+
+        // Sorted by name; "#" cannot start an attribute name.
+        std::map<std::string, size_t> accessors;
+        const rj::Value& attributes = prim["attributes"];
+        for ( auto it = attributes.MemberBegin(); it != attributes.MemberEnd(); ++it )
+        {
+            if ( !it->value.IsUint() )
+                return {};
+            accessors[it->name.GetString()] = it->value.GetUint();
+        }
+        if ( prim.HasMember( "indices" ) )
+        {
+            if ( !prim["indices"].IsUint() )
+                return {};
+            accessors["#indices"] = prim["indices"].GetUint();
+        }
+        for ( const auto& [name, accessor] : accessors )
+        {
+            s.layout += name + ' ';
+            s.accessors.push_back( accessor );
+        }
+        s.layout += ';';
+    }
+    s.valid = true;
+    return s;
+}
+
+// For every mesh, the first mesh identical to it (its own index if none).
+// Hashes find the candidates; the data is then compared.
+static std::vector<size_t> identicalMeshes( const GltfFile& f )
+{
+    const rj::Value& meshes = f.json["meshes"];
+    std::vector<size_t>    twins( meshes.Size() );
+    std::vector<MeshShape> shapes( meshes.Size() );
+    std::unordered_map<size_t, std::optional<uint64_t>>  accessorHashes; // nullopt: not plain data
+    std::unordered_map<uint64_t, std::vector<size_t>>    firsts;
+
+    for ( size_t m = 0; m < meshes.Size(); ++m )
+    {
+        twins[m]  = m;
+        shapes[m] = meshShape( meshes[m] );
+        if ( !shapes[m].valid )
+            continue;
+
+        ContentHash h;
+        h.add( std::string_view( shapes[m].layout ) );
+        for ( size_t a : shapes[m].accessors )
+        {
+            auto it = accessorHashes.find( a );
+            if ( it == accessorHashes.end() )
+            {
+                const AccessorData data = accessorData( f, a );
+                it = accessorHashes.emplace( a, data.data ? std::optional( accessorHash( data ) ) : std::nullopt ).first;
+            }
+            if ( !it->second )
+            {
+                shapes[m].valid = false;
+                break;
+            }
+            h.add( *it->second );
+        }
+        if ( !shapes[m].valid )
+            continue;
+
+        auto& candidates = firsts[h.value()];
+        for ( size_t c : candidates )
+        {
+            bool same = shapes[c].layout == shapes[m].layout;
+            for ( size_t i = 0; same && i < shapes[m].accessors.size(); ++i )
+                same = shapes[c].accessors[i] == shapes[m].accessors[i] ||
+                       sameData( accessorData( f, shapes[c].accessors[i] ), accessorData( f, shapes[m].accessors[i] ) );
+            if ( same )
+            {
+                twins[m] = c;
+                break;
+            }
+        }
+        if ( twins[m] == m )
+            candidates.push_back( m );
+    }
+    return twins;
+}
+
+// Remove the meshes flagged in `removed`, which no node draws any more, and
+// renumber the nodes' references to the others.
+static void removeMeshes( rj::Document& doc, const std::vector<bool>& removed )
+{
+    auto& alloc = doc.GetAllocator();
+    const size_t meshCount = removed.size();
+    std::vector<unsigned int> index( meshCount, ~0u );
+    rj::Value meshes( rj::kArrayType );
+    for ( size_t m = 0; m < meshCount; ++m )
+        if ( !removed[m] )
+        {
+            index[m] = meshes.Size();
+            meshes.PushBack( doc["meshes"][m], alloc ); // moves
+        }
+    doc["meshes"] = meshes;
+
+    for ( auto& node : doc["nodes"].GetArray() )
+        if ( node.HasMember( "mesh" ) && node["mesh"].IsUint() && node["mesh"].GetUint() < meshCount )
+            node["mesh"].SetUint( index[node["mesh"].GetUint()] );
+}
+
+// ── Node transforms ──────────────────────────────────────────────────────────
+
+struct Transform
+{
+    std::array<float, 3> t = { 0, 0, 0 };
+    std::array<float, 4> r = { 0, 0, 0, 1 }; // quaternion xyzw
+    std::array<float, 3> s = { 1, 1, 1 };
+};
+
+// Array member `name` of `v` into `out`; false if it is present but malformed.
+template <size_t N>
+static bool readNumbers( const rj::Value& v, const char* name, std::array<float, N>& out )
+{
+    if ( !v.HasMember( name ) )
+        return true;
+    const rj::Value& a = v[name];
+    if ( !a.IsArray() || a.Size() != N )
+        return false;
+    for ( size_t i = 0; i < N; ++i )
+    {
+        if ( !a[i].IsNumber() )
+            return false;
+        out[i] = static_cast<float>( a[i].GetDouble() );
+    }
+    return true;
+}
+
+// Rotation matrix (columns `axes`) to a unit quaternion.
+static std::array<float, 4> toQuaternion( const float axes[3][3] )
+{
+    auto r = [&]( int row, int col ) { return axes[col][row]; };
+    std::array<float, 4> q;
+    const float trace = r( 0, 0 ) + r( 1, 1 ) + r( 2, 2 );
+    if ( trace > 0 )
+    {
+        const float s = std::sqrt( trace + 1.0f ) * 2;
+        q = { ( r( 2, 1 ) - r( 1, 2 ) ) / s, ( r( 0, 2 ) - r( 2, 0 ) ) / s, ( r( 1, 0 ) - r( 0, 1 ) ) / s, 0.25f * s };
+    }
+    else if ( r( 0, 0 ) > r( 1, 1 ) && r( 0, 0 ) > r( 2, 2 ) )
+    {
+        const float s = std::sqrt( 1.0f + r( 0, 0 ) - r( 1, 1 ) - r( 2, 2 ) ) * 2;
+        q = { 0.25f * s, ( r( 0, 1 ) + r( 1, 0 ) ) / s, ( r( 0, 2 ) + r( 2, 0 ) ) / s, ( r( 2, 1 ) - r( 1, 2 ) ) / s };
+    }
+    else if ( r( 1, 1 ) > r( 2, 2 ) )
+    {
+        const float s = std::sqrt( 1.0f + r( 1, 1 ) - r( 0, 0 ) - r( 2, 2 ) ) * 2;
+        q = { ( r( 0, 1 ) + r( 1, 0 ) ) / s, 0.25f * s, ( r( 1, 2 ) + r( 2, 1 ) ) / s, ( r( 0, 2 ) - r( 2, 0 ) ) / s };
+    }
+    else
+    {
+        const float s = std::sqrt( 1.0f + r( 2, 2 ) - r( 0, 0 ) - r( 1, 1 ) ) * 2;
+        q = { ( r( 0, 2 ) + r( 2, 0 ) ) / s, ( r( 1, 2 ) + r( 2, 1 ) ) / s, 0.25f * s, ( r( 1, 0 ) - r( 0, 1 ) ) / s };
+    }
+    const float length = std::sqrt( q[0] * q[0] + q[1] * q[1] + q[2] * q[2] + q[3] * q[3] );
+    for ( float& c : q )
+        c /= length;
+    return q;
+}
+
+// A node's TRS, decomposed from its matrix if it has one; nullopt for a
+// matrix with shear or projection, or malformed members.
+static std::optional<Transform> nodeTransform( const rj::Value& node )
+{
+    Transform tr;
+    if ( !node.HasMember( "matrix" ) )
+    {
+        if ( readNumbers( node, "translation", tr.t ) && readNumbers( node, "rotation", tr.r ) &&
+             readNumbers( node, "scale", tr.s ) )
+            return tr;
+        return std::nullopt;
+    }
+
+    constexpr float kTolerance = 1e-5f;
+    std::array<float, 16> m; // column-major
+    if ( !readNumbers( node, "matrix", m ) || std::abs( m[3] ) > kTolerance || std::abs( m[7] ) > kTolerance ||
+         std::abs( m[11] ) > kTolerance || std::abs( m[15] - 1 ) > kTolerance )
+        return std::nullopt;
+
+    tr.t = { m[12], m[13], m[14] };
+    float axes[3][3];
+    for ( int c = 0; c < 3; ++c )
+    {
+        const float* column = &m[c * 4];
+        tr.s[c] = std::sqrt( column[0] * column[0] + column[1] * column[1] + column[2] * column[2] );
+        if ( !( tr.s[c] > 0 ) )
+            return std::nullopt;
+        for ( int r = 0; r < 3; ++r )
+            axes[c][r] = column[r] / tr.s[c];
+    }
+    auto dot = []( const float* a, const float* b ) { return a[0] * b[0] + a[1] * b[1] + a[2] * b[2]; };
+    if ( std::abs( dot( axes[0], axes[1] ) ) > 1e-4f || std::abs( dot( axes[0], axes[2] ) ) > 1e-4f ||
+         std::abs( dot( axes[1], axes[2] ) ) > 1e-4f )
+        return std::nullopt;
+
+    // A mirroring matrix keeps a rotation with one negative scale.
+    const float cross[3] = { axes[1][1] * axes[2][2] - axes[1][2] * axes[2][1],
+                             axes[1][2] * axes[2][0] - axes[1][0] * axes[2][2],
+                             axes[1][0] * axes[2][1] - axes[1][1] * axes[2][0] };
+    if ( dot( axes[0], cross ) < 0 )
+    {
+        tr.s[0] = -tr.s[0];
+        for ( float& x : axes[0] )
+            x = -x;
+    }
+    tr.r = toQuaternion( axes );
+    return tr;
+}
+
+// ── Instancing ───────────────────────────────────────────────────────────────
+
+template <size_t N>
+static std::vector<uint8_t> floatBytes( const std::vector<std::array<float, N>>& v )
+{
+    std::vector<uint8_t> out( v.size() * N * sizeof( float ) );
+    std::memcpy( out.data(), v.data(), out.size() );
+    return out;
+}
+
+// Nodes that may become an instance: leaves drawing a mesh with a plain TRS,
+// and nothing else referring to them but their single parent or scene.
+static std::vector<std::optional<Transform>> instanceableNodes( const rj::Document& doc )
+{
+    const rj::Value& nodes = doc["nodes"];
+    const size_t nodeCount = nodes.Size();
+    std::vector<bool> pinned( nodeCount, false ); // skin joints and animation targets
+    auto pin = [&]( const rj::Value& v ) {
+        if ( v.IsUint() && v.GetUint() < nodeCount )
+            pinned[v.GetUint()] = true;
+    };
+    if ( doc.HasMember( "skins" ) )
+        for ( const auto& skin : doc["skins"].GetArray() )
+        {
+            if ( skin.HasMember( "joints" ) )
+                for ( const auto& joint : skin["joints"].GetArray() )
+                    pin( joint );
+            if ( skin.HasMember( "skeleton" ) )
+                pin( skin["skeleton"] );
+        }
+    if ( doc.HasMember( "animations" ) )
+        for ( const auto& anim : doc["animations"].GetArray() )
+            if ( anim.HasMember( "channels" ) )
+                for ( const auto& channel : anim["channels"].GetArray() )
+                    if ( channel.HasMember( "target" ) && channel["target"].HasMember( "node" ) )
+                        pin( channel["target"]["node"] );
+
+    std::vector<std::optional<Transform>> transforms( nodeCount );
+    for ( size_t n = 0; n < nodeCount; ++n )
+    {
+        const rj::Value& node = nodes[n];
+        const bool leaf = !node.HasMember( "children" ) || ( node["children"].IsArray() && node["children"].Empty() );
+        if ( !pinned[n] && leaf && node.HasMember( "mesh" ) && node["mesh"].IsUint() && !node.HasMember( "skin" ) &&
+             !node.HasMember( "camera" ) && !node.HasMember( "weights" ) && !node.HasMember( "extensions" ) )
+            transforms[n] = nodeTransform( node );
+    }
+    return transforms;
+}
+
+// Replace every group of sibling instanceable nodes drawing the same mesh by
+// its first node, instanced. Returns the nodes to remove.
+static std::vector<bool> instanceNodes( GltfFile& f, PendingViews& views, InstanceInfo& info )
+{
+    rj::Document& doc = f.json;
+    auto& alloc = doc.GetAllocator();
+    const size_t nodeCount = doc["nodes"].Size();
+    const auto transforms = instanceableNodes( doc );
+
+    // Where each node hangs: its parent, or nodeCount + its scene. Nodes with
+    // several places (or none) stay as they are.
+    constexpr size_t kNowhere = ~size_t( 0 );
+    std::vector<size_t>       place( nodeCount, kNowhere );
+    std::vector<unsigned int> places( nodeCount, 0 );
+    auto hang = [&]( const rj::Value& child, size_t where ) {
+        if ( child.IsUint() && child.GetUint() < nodeCount )
+        {
+            place[child.GetUint()] = where;
+            ++places[child.GetUint()];
+        }
+    };
+    for ( size_t n = 0; n < nodeCount; ++n )
+        if ( doc["nodes"][n].HasMember( "children" ) && doc["nodes"][n]["children"].IsArray() )
+            for ( const auto& child : doc["nodes"][n]["children"].GetArray() )
+                hang( child, n );
+    if ( doc.HasMember( "scenes" ) )
+        for ( size_t s = 0; s < doc["scenes"].Size(); ++s )
+            if ( doc["scenes"][s].HasMember( "nodes" ) && doc["scenes"][s]["nodes"].IsArray() )
+                for ( const auto& root : doc["scenes"][s]["nodes"].GetArray() )
+                    hang( root, nodeCount + s );
+
+    std::map<std::pair<size_t, size_t>, std::vector<size_t>> groups; // ( place, mesh ) -> nodes
+    for ( size_t n = 0; n < nodeCount; ++n )
+        if ( transforms[n] && places[n] == 1 )
+            groups[{ place[n], doc["nodes"][n]["mesh"].GetUint() }].push_back( n );
+
+    std::vector<bool> removed( nodeCount, false );
+    for ( const auto& [key, group] : groups )
+    {
+        if ( group.size() < 2 )
+            continue;
+
+        std::vector<std::array<float, 3>> translation, scale;
+        std::vector<std::array<float, 4>> rotation;
+        bool rotated = false, scaled = false;
+        for ( size_t n : group )
+        {
+            const Transform& tr = *transforms[n];
+            translation.push_back( tr.t );
+            rotation.push_back( tr.r );
+            scale.push_back( tr.s );
+            rotated = rotated || tr.r != std::array<float, 4>{ 0, 0, 0, 1 };
+            scaled  = scaled || tr.s != std::array<float, 3>{ 1, 1, 1 };
+            removed[n] = n != group.front();
+        }
+
+        // TRANSLATION is always written: it gives the instance count.
+        rj::Value attributes( rj::kObjectType );
+        attributes.AddMember( "TRANSLATION",
+            addAccessor( f, views, floatBytes( translation ), 0, GltfFloat, "VEC3", group.size(), GltfPlain ), alloc );
+        if ( rotated )
+            attributes.AddMember( "ROTATION",
+                addAccessor( f, views, floatBytes( rotation ), 0, GltfFloat, "VEC4", group.size(), GltfPlain ), alloc );
+        if ( scaled )
+            attributes.AddMember( "SCALE",
+                addAccessor( f, views, floatBytes( scale ), 0, GltfFloat, "VEC3", group.size(), GltfPlain ), alloc );
+        rj::Value instancing( rj::kObjectType );
+        instancing.AddMember( "attributes", attributes, alloc );
+        rj::Value extensions( rj::kObjectType );
+        extensions.AddMember( rj::StringRef( kExtension ), instancing, alloc );
+
+        rj::Value& node = doc["nodes"][group.front()];
+        for ( const char* member : { "matrix", "translation", "rotation", "scale" } )
+            node.RemoveMember( member );
+        node.AddMember( "extensions", extensions, alloc );
+
+        ++info.instancedNodes;
+        info.instances += static_cast<unsigned int>( group.size() );
+    }
+    return removed;
+}
+
+// Remove the nodes flagged in `removed` (leaves only their parent or scene
+// refers to) and renumber the references to the others.
+static void removeNodes( rj::Document& doc, const std::vector<bool>& removed )
+{
+    auto& alloc = doc.GetAllocator();
+    const size_t nodeCount = removed.size();
+    std::vector<unsigned int> index( nodeCount, ~0u );
+    rj::Value nodes( rj::kArrayType );
+    for ( size_t n = 0; n < nodeCount; ++n )
+        if ( !removed[n] )
+        {
+            index[n] = nodes.Size();
+            nodes.PushBack( doc["nodes"][n], alloc ); // moves
+        }
+    doc["nodes"] = nodes;
+
+    auto remap = [&]( rj::Value& v ) {
+        if ( v.IsUint() && v.GetUint() < nodeCount )
+            v.SetUint( index[v.GetUint()] );
+    };
+    auto remapList = [&]( rj::Value& list ) {
+        if ( !list.IsArray() )
+            return;
+        rj::Value kept( rj::kArrayType );
+        for ( auto& v : list.GetArray() )
+            if ( !v.IsUint() || v.GetUint() >= nodeCount || !removed[v.GetUint()] )
+            {
+                remap( v );
+                kept.PushBack( v, alloc ); // moves
+            }
+        list = kept;
+    };
+
+    for ( auto& node : doc["nodes"].GetArray() )
+        if ( node.HasMember( "children" ) )
+            remapList( node["children"] );
+    if ( doc.HasMember( "scenes" ) )
+        for ( auto& scene : doc["scenes"].GetArray() )
+            if ( scene.HasMember( "nodes" ) )
+                remapList( scene["nodes"] );
+    if ( doc.HasMember( "skins" ) )
+        for ( auto& skin : doc["skins"].GetArray() )
+        {
+            if ( skin.HasMember( "joints" ) )
+                remapList( skin["joints"] );
+            if ( skin.HasMember( "skeleton" ) )
+                remap( skin["skeleton"] );
+        }
+    if ( doc.HasMember( "animations" ) )
+        for ( auto& anim : doc["animations"].GetArray() )
+            if ( anim.HasMember( "channels" ) )
+                for ( auto& channel : anim["channels"].GetArray() )
+                    if ( channel.HasMember( "target" ) && channel["target"].HasMember( "node" ) )
+                        remap( channel["target"]["node"] );
+}
+
+// ── Entry point ──────────────────────────────────────────────────────────────
+
+Result<InstanceInfo> instanceGltf( const fs::path& path )
+{
+    auto file = readGltf( path );
+    if ( !file )
+        return std::unexpected( file.error() );
+    GltfFile& f = *file;
+    rj::Document& doc = f.json;
+
+    InstanceInfo info;
+    if ( !doc.HasMember( "meshes" ) || !doc.HasMember( "nodes" ) || !doc.HasMember( "accessors" ) ||
+         !doc.HasMember( "bufferViews" ) )
+        return info;
+    if ( doc.HasMember( "buffers" ) && doc["buffers"].Size() > 1 )
+        return gltfError( "Instance", path, "only files with a single buffer are supported" );
+
+    // Nodes draw the first of identical meshes; the accessors of the others
+    // go unless something else uses them.
+    const std::vector<size_t> twins = identicalMeshes( f );
+    std::vector<bool> merged( twins.size(), false );
+    std::vector<bool> dropped( doc["accessors"].Size(), false );
+    for ( size_t m = 0; m < twins.size(); ++m )
+    {
+        if ( twins[m] == m )
+            continue;
+        merged[m] = true;
+        ++info.meshesMerged;
+        // meshShape checked the primitives: every accessor index is valid.
+        for ( const auto& prim : doc["meshes"][m]["primitives"].GetArray() )
+        {
+            const rj::Value& attributes = prim["attributes"];
+            for ( auto it = attributes.MemberBegin(); it != attributes.MemberEnd(); ++it )
+                dropped[it->value.GetUint()] = true;
+            if ( prim.HasMember( "indices" ) )
+                dropped[prim["indices"].GetUint()] = true;
+        }
+    }
+    if ( info.meshesMerged > 0 )
+    {
+        for ( auto& node : doc["nodes"].GetArray() )
+            if ( node.HasMember( "mesh" ) && node["mesh"].IsUint() && node["mesh"].GetUint() < twins.size() )
+                node["mesh"].SetUint( static_cast<unsigned int>( twins[node["mesh"].GetUint()] ) );
+        removeMeshes( doc, merged );
+    }
+
+    PendingViews views;
+    views.firstView = doc["bufferViews"].Size();
+    const std::vector<bool> removed = instanceNodes( f, views, info );
+    if ( info.instancedNodes > 0 )
+    {
+        removeNodes( doc, removed );
+        requireExtension( doc, kExtension );
+    }
+
+    if ( info.meshesMerged == 0 && info.instancedNodes == 0 )
+        return info;
+    repackGltf( f, dropped, views );
+    if ( auto r = writeGltf( f, path ); !r )
+        return std::unexpected( r.error() );
+    return info;
+}
+
+} // namespace lodgen
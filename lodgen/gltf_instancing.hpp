@@ -0,0 +1,35 @@
+#pragma once
+#include "types.hpp"
+
+namespace lodgen
+{
+
+// GPU instancing of exported glTF files (EXT_mesh_gpu_instancing).
+//
+// assimp writes every aiMesh as a glTF mesh of its own and every node with its
+// own transform, so geometry a scene repeats stays repeated in the file.
+// instanceGltf rewrites the saved file:
+//   meshes   byte-identical meshes (same primitives, materials and accessor
+//            data) are merged into the first of them
+//   nodes    sibling leaf nodes drawing the same mesh become one node whose
+//            EXT_mesh_gpu_instancing TRANSLATION / ROTATION / SCALE carry
+//            their transforms; the others are removed
+// Nodes that are animated, skinned, skin joints, or carry a camera, morph
+// weights, extensions or a sheared matrix keep their own node. Removed nodes
+// take their names with them. Meshes with morph targets are never merged.
+
+struct InstanceInfo
+{
+    unsigned int meshesMerged   = 0; // meshes replaced by an identical one
+    unsigned int instancedNodes = 0; // nodes carrying EXT_mesh_gpu_instancing
+    unsigned int instances      = 0; // instances they draw
+};
+
+// True for outputs instanceGltf can rewrite (.gltf with an external buffer, .glb).
+bool canInstance( const fs::path& path );
+
+// Merge identical meshes and instance repeated nodes of the glTF file at
+// `path` in place. The file is left untouched if there is nothing to share.
+Result<InstanceInfo> instanceGltf( const fs::path& path );
+
+} // namespace lodgen
@@ -0,0 +1,418 @@
+#include "gltf_quantize.hpp"
+#include "gltf_file.hpp"
+#include <meshoptimizer.h>
+#include <algorithm>
+#include <array>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <map>
+#include <optional>
+#include <set>
+#include <tuple>
+#include <vector>
+
+namespace lodgen
+{
+
+bool canQuantize( const fs::path& path )
+{
+    return isGltfPath( path );
+}
+
+// ── Accessors ────────────────────────────────────────────────────────────────
+
+// Float data of accessor `index`: plain float `components`-vectors in buffer 0,
+// not sparse. Empty otherwise.
+static std::vector<float> readFloats( const GltfFile& f, size_t index, unsigned int components )
+{
+    const rj::Value& accessors = f.json["accessors"];
+    const rj::Value& views     = f.json["bufferViews"];
+    if ( index >= accessors.Size() )
+        return {};
+    const rj::Value& accessor = accessors[index];
+    if ( uintMember( accessor, "componentType" ) != GltfFloat || componentCount( accessor ) != components ||
+         accessor.HasMember( "sparse" ) || !accessor.HasMember( "bufferView" ) )
+        return {};
+    const size_t viewIndex = uintMember( accessor, "bufferView" );
+    if ( viewIndex >= views.Size() || uintMember( views[viewIndex], "buffer" ) != 0 )
+        return {};
+
+    const rj::Value& view = views[viewIndex];
+    const size_t elementSize = components * sizeof( float );
+    const size_t count  = uintMember( accessor, "count" );
+    const size_t stride = uintMember( view, "byteStride", elementSize );
+    const size_t offset = uintMember( view, "byteOffset" ) + uintMember( accessor, "byteOffset" );
+    if ( count == 0 || offset + stride * ( count - 1 ) + elementSize > f.bin.size() )
+        return {};
+
+    std::vector<float> out( count * components );
+    for ( size_t i = 0; i < count; ++i )
+        std::memcpy( &out[i * components], f.bin.data() + offset + i * stride, elementSize );
+    return out;
+}
+
+// Quantized attributes: normalized integers in vertex buffer views.
+static constexpr unsigned int kQuantized = GltfNormalized | GltfVertexData;
+
+template <typename T>
+static void store( std::vector<uint8_t>& data, size_t at, T value )
+{
+    std::memcpy( data.data() + at, &value, sizeof( T ) );
+}
+
+// int16 normalized in [center - scale, center + scale], padded to 8 bytes.
+static std::optional<unsigned int> quantizePositions(
+    GltfFile& f, PendingViews& views, const std::vector<float>& p, const float* center, float scale )
+{
+    const size_t count = p.size() / 3;
+    std::vector<uint8_t> data( count * 8, 0 );
+    int lo[3] = { 32767, 32767, 32767 }, hi[3] = { -32767, -32767, -32767 };
+    for ( size_t i = 0; i < count; ++i )
+        for ( int c = 0; c < 3; ++c )
+        {
+            const int q = meshopt_quantizeSnorm( ( p[i * 3 + c] - center[c] ) / scale, 16 );
+            store( data, i * 8 + c * 2, int16_t( q ) );
+            lo[c] = std::min( lo[c], q );
+            hi[c] = std::max( hi[c], q );
+        }
+
+    const unsigned int index = addAccessor( f, views, std::move( data ), 8, GltfShort, "VEC3", count, kQuantized );
+    auto& alloc = f.json.GetAllocator();
+    rj::Value min( rj::kArrayType ), max( rj::kArrayType );
+    for ( int c = 0; c < 3; ++c )
+    {
+        min.PushBack( lo[c], alloc );
+        max.PushBack( hi[c], alloc );
+    }
+    f.json["accessors"][index].AddMember( "min", min, alloc );
+    f.json["accessors"][index].AddMember( "max", max, alloc );
+    return index;
+}
+
+// Unit vectors (xyz normalized; a tangent's w sign kept) to int8 / int16.
+static std::optional<unsigned int> quantizeDirections(
+    GltfFile& f, PendingViews& views, const std::vector<float>& v, unsigned int components, unsigned int bits )
+{
+    const size_t count  = v.size() / components;
+    const size_t size   = bits / 8;
+    const size_t stride = ( components * size + 3 ) & ~size_t( 3 );
+    std::vector<uint8_t> data( count * stride, 0 );
+    for ( size_t i = 0; i < count; ++i )
+    {
+        const float* e = &v[i * components];
+        const float length = std::sqrt( e[0] * e[0] + e[1] * e[1] + e[2] * e[2] );
+        const float inv = length > 0 ? 1.0f / length : 0.0f;
+        for ( unsigned int c = 0; c < components; ++c )
+        {
+            const float x = c < 3 ? e[c] * inv : ( e[c] < 0 ? -1.0f : 1.0f );
+            const int q = meshopt_quantizeSnorm( x, int( bits ) );
+            if ( bits == 8 )
+                store( data, i * stride + c, int8_t( q ) );
+            else
+                store( data, i * stride + c * 2, int16_t( q ) );
+        }
+    }
+    return addAccessor( f, views, std::move( data ), stride, bits == 8 ? GltfByte : GltfShort,
+                        components == 3 ? "VEC3" : "VEC4", count, kQuantized );
+}
+
+// uint16 normalized; only if every coordinate lies in [0, 1].
+static std::optional<unsigned int> quantizeUVs( GltfFile& f, PendingViews& views, const std::vector<float>& uv )
+{
+    if ( std::any_of( uv.begin(), uv.end(), []( float x ) { return !( x >= 0.0f && x <= 1.0f ); } ) )
+        return std::nullopt;
+    const size_t count = uv.size() / 2;
+    std::vector<uint8_t> data( count * 4 );
+    for ( size_t i = 0; i < uv.size(); ++i )
+        store( data, i * 2, uint16_t( meshopt_quantizeUnorm( uv[i], 16 ) ) );
+    return addAccessor( f, views, std::move( data ), 4, GltfUnsignedShort, "VEC2", count, kQuantized );
+}
+
+// uint8 normalized, padded to 4 bytes.
+static std::optional<unsigned int> quantizeColors(
+    GltfFile& f, PendingViews& views, const std::vector<float>& color, unsigned int components )
+{
+    const size_t count = color.size() / components;
+    std::vector<uint8_t> data( count * 4, 0 );
+    for ( size_t i = 0; i < count; ++i )
+        for ( unsigned int c = 0; c < components; ++c )
+            data[i * 4 + c] = uint8_t( meshopt_quantizeUnorm( std::clamp( color[i * components + c], 0.0f, 1.0f ), 8 ) );
+    return addAccessor( f, views, std::move( data ), 4, GltfUnsignedByte, components == 3 ? "VEC3" : "VEC4", count, kQuantized );
+}
+
+// ── Instances ────────────────────────────────────────────────────────────────
+//
+// A mesh drawn through EXT_mesh_gpu_instancing cannot move to a dequantizing
+// child: the instances belong to the node drawing it. The dequantizing
+// transform goes into every instance instead.
+
+static const rj::Value* instancingAttributes( const rj::Value& node )
+{
+    if ( !node.HasMember( "extensions" ) || !node["extensions"].HasMember( "EXT_mesh_gpu_instancing" ) ||
+         !node["extensions"]["EXT_mesh_gpu_instancing"].HasMember( "attributes" ) )
+        return nullptr;
+    return &node["extensions"]["EXT_mesh_gpu_instancing"]["attributes"];
+}
+
+// Instance transforms, absent attributes filled in.
+struct Instances
+{
+    std::vector<float> translation, rotation, scale;
+    size_t             count = 0;
+};
+
+// Nullopt if an attribute is not plain float data.
+static std::optional<Instances> readInstances( const GltfFile& f, const rj::Value& attributes )
+{
+    Instances in;
+    for ( auto [name, components, values] : { std::tuple( "TRANSLATION", 3u, &in.translation ),
+                                               std::tuple( "ROTATION", 4u, &in.rotation ),
+                                               std::tuple( "SCALE", 3u, &in.scale ) } )
+    {
+        if ( !attributes.HasMember( name ) )
+            continue;
+        if ( !attributes[name].IsUint() ||
+             ( *values = readFloats( f, attributes[name].GetUint(), components ) ).empty() ||
+             ( in.count != 0 && in.count != values->size() / components ) )
+            return std::nullopt;
+        in.count = values->size() / components;
+    }
+    if ( in.count == 0 )
+        return std::nullopt;
+    if ( in.translation.empty() )
+        in.translation.assign( in.count * 3, 0.0f );
+    if ( in.rotation.empty() )
+        for ( size_t i = 0; i < in.count; ++i )
+            in.rotation.insert( in.rotation.end(), { 0.0f, 0.0f, 0.0f, 1.0f } );
+    if ( in.scale.empty() )
+        in.scale.assign( in.count * 3, 1.0f );
+    return in;
+}
+
+// Instance T R S becomes T + R (S * center), R, S * scale.
+static void dequantizeInstances( GltfFile& f, PendingViews& views, std::vector<bool>& replaced,
+                                 rj::Value& attributes, const std::array<float, 4>& dequantize )
+{
+    Instances in = *readInstances( f, attributes );
+    for ( size_t i = 0; i < in.count; ++i )
+    {
+        float* t = &in.translation[i * 3];
+        float* s = &in.scale[i * 3];
+        const float* q = &in.rotation[i * 4];
+        const float v[3] = { s[0] * dequantize[0], s[1] * dequantize[1], s[2] * dequantize[2] };
+
+        // v + 2 q.xyz x ( q.xyz x v + w v )
+        const float u[3] = { q[1] * v[2] - q[2] * v[1] + q[3] * v[0],
+                             q[2] * v[0] - q[0] * v[2] + q[3] * v[1],
+                             q[0] * v[1] - q[1] * v[0] + q[3] * v[2] };
+        t[0] += v[0] + 2 * ( q[1] * u[2] - q[2] * u[1] );
+        t[1] += v[1] + 2 * ( q[2] * u[0] - q[0] * u[2] );
+        t[2] += v[2] + 2 * ( q[0] * u[1] - q[1] * u[0] );
+        for ( int c = 0; c < 3; ++c )
+            s[c] *= dequantize[3];
+    }
+
+    auto& alloc = f.json.GetAllocator();
+    for ( auto [name, values] : { std::pair( "TRANSLATION", &in.translation ), std::pair( "SCALE", &in.scale ) } )
+    {
+        std::vector<uint8_t> data( values->size() * sizeof( float ) );
+        std::memcpy( data.data(), values->data(), data.size() );
+        const unsigned int index = addAccessor( f, views, std::move( data ), 0, GltfFloat, "VEC3", in.count, GltfPlain );
+        if ( attributes.HasMember( name ) )
+        {
+            if ( attributes[name].GetUint() < replaced.size() )
+                replaced[attributes[name].GetUint()] = true;
+            attributes[name].SetUint( index );
+        }
+        else
+            attributes.AddMember( rj::StringRef( name ), index, alloc );
+    }
+}
+
+// ── Quantization ─────────────────────────────────────────────────────────────
+
+VoidResult quantizeGltf( const fs::path& path, const QuantizeOptions& opts )
+{
+    auto file = readGltf( path );
+    if ( !file )
+        return std::unexpected( file.error() );
+    GltfFile& f = *file;
+    rj::Document& doc = f.json;
+    auto& alloc = doc.GetAllocator();
+
+    if ( !doc.HasMember( "meshes" ) || !doc.HasMember( "accessors" ) || !doc.HasMember( "bufferViews" ) )
+        return {};
+    if ( doc.HasMember( "buffers" ) && doc["buffers"].Size() > 1 )
+        return gltfError( "Quantize", path, "only files with a single buffer are supported" );
+    const unsigned int normalBits = opts.normalBits > 8 ? 16 : 8;
+
+    // A node transform does not apply to skinned vertices, and morph targets
+    // would need quantizing the same way; those meshes keep float positions,
+    // as do meshes instanced with transforms that are not plain floats.
+    std::set<size_t> floatPositions;
+    if ( doc.HasMember( "nodes" ) )
+        for ( const auto& node : doc["nodes"].GetArray() )
+        {
+            if ( !node.HasMember( "mesh" ) )
+                continue;
+            const rj::Value* instances = instancingAttributes( node );
+            if ( node.HasMember( "skin" ) || ( instances && !readInstances( f, *instances ) ) )
+                floatPositions.insert( uintMember( node, "mesh" ) );
+        }
+
+    PendingViews views;
+    views.firstView = doc["bufferViews"].Size();
+    std::vector<bool> replaced( doc["accessors"].Size(), false );
+    std::map<std::pair<size_t, size_t>, unsigned int> done; // ( accessor, mesh for POSITION ) -> quantized
+    std::map<size_t, std::array<float, 4>> dequantize;      // mesh -> center xyz, scale
+    bool needsExtension = false;
+
+    rj::Value& meshes = doc["meshes"];
+    for ( size_t m = 0; m < meshes.Size(); ++m )
+    {
+        if ( !meshes[m].HasMember( "primitives" ) )
+            continue;
+        const size_t primCount = meshes[m]["primitives"].Size();
+
+        // One grid for all primitives: they share the node transform.
+        bool  quantizePos = opts.positions && !floatPositions.count( m );
+        float lo[3] = { FLT_MAX, FLT_MAX, FLT_MAX }, hi[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+        std::vector<std::vector<float>> positions( primCount );
+        for ( size_t p = 0; p < primCount && quantizePos; ++p )
+        {
+            const rj::Value& prim = meshes[m]["primitives"][p];
+            if ( prim.HasMember( "targets" ) || !prim.HasMember( "attributes" ) ||
+                 !prim["attributes"].HasMember( "POSITION" ) ||
+                 ( positions[p] = readFloats( f, uintMember( prim["attributes"], "POSITION" ), 3 ) ).empty() )
+            {
+                quantizePos = false;
+                break;
+            }
+            for ( size_t i = 0; i < positions[p].size(); ++i )
+            {
+                lo[i % 3] = std::min( lo[i % 3], positions[p][i] );
+                hi[i % 3] = std::max( hi[i % 3], positions[p][i] );
+            }
+        }
+        float center[3] = {}, scale = 1.0f;
+        if ( quantizePos )
+        {
+            scale = 0;
+            for ( int c = 0; c < 3; ++c )
+            {
+                center[c] = 0.5f * ( lo[c] + hi[c] );
+                scale     = std::max( scale, 0.5f * ( hi[c] - lo[c] ) );
+            }
+            if ( !( scale > 0 ) )
+                scale = 1.0f;
+            dequantize[m] = { center[0], center[1], center[2], scale };
+        }
+
+        for ( size_t p = 0; p < primCount; ++p )
+        {
+            if ( !meshes[m]["primitives"][p].HasMember( "attributes" ) )
+                continue;
+
+            std::vector<std::string> names;
+            const rj::Value& attributes = meshes[m]["primitives"][p]["attributes"];
+            for ( auto it = attributes.MemberBegin(); it != attributes.MemberEnd(); ++it )
+                if ( it->value.IsUint() )
+                    names.push_back( it->name.GetString() );
+
+            for ( const std::string& name : names )
+            {
+                const size_t accessor = meshes[m]["primitives"][p]["attributes"][name.c_str()].GetUint();
+                const bool   isPos    = name == "POSITION";
+                if ( isPos && !quantizePos )
+                    continue;
+
+                const auto key = std::make_pair( accessor, isPos ? m : ~size_t( 0 ) );
+                std::optional<unsigned int> q;
+                if ( auto it = done.find( key ); it != done.end() )
+                    q = it->second;
+                else if ( isPos )
+                    q = quantizePositions( f, views, positions[p], center, scale );
+                else if ( name == "NORMAL" || name == "TANGENT" )
+                {
+                    const unsigned int components = name == "NORMAL" ? 3 : 4;
+                    auto v = readFloats( f, accessor, components );
+                    if ( !v.empty() )
+                        q = quantizeDirections( f, views, v, components, normalBits );
+                }
+                else if ( name.starts_with( "TEXCOORD_" ) )
+                {
+                    auto uv = readFloats( f, accessor, 2 );
+                    if ( !uv.empty() )
+                        q = quantizeUVs( f, views, uv );
+                }
+                else if ( name.starts_with( "COLOR_" ) )
+                {
+                    for ( unsigned int components : { 4u, 3u } )
+                        if ( auto c = readFloats( f, accessor, components ); !c.empty() )
+                        {
+                            q = quantizeColors( f, views, c, components );
+                            break;
+                        }
+                }
+                if ( !q )
+                    continue;
+
+                done[key] = *q;
+                if ( accessor < replaced.size() )
+                    replaced[accessor] = true;
+                meshes[m]["primitives"][p]["attributes"][name.c_str()].SetUint( *q );
+                // Core glTF allows normalized integer UVs and colors; the rest needs the extension.
+                needsExtension = needsExtension || isPos || name == "NORMAL" || name == "TANGENT";
+            }
+        }
+    }
+
+    if ( done.empty() )
+        return {};
+
+    // Every node drawing a mesh with quantized positions hands the mesh to a
+    // new child whose transform maps the int16 grid back into place; an
+    // instanced node takes that transform into its instances.
+    if ( doc.HasMember( "nodes" ) )
+    {
+        const size_t nodeCount = doc["nodes"].Size();
+        for ( size_t n = 0; n < nodeCount; ++n )
+        {
+            auto it = dequantize.find( uintMember( doc["nodes"][n], "mesh", ~size_t( 0 ) ) );
+            if ( !doc["nodes"][n].HasMember( "mesh" ) || it == dequantize.end() )
+                continue;
+            if ( instancingAttributes( doc["nodes"][n] ) )
+            {
+                dequantizeInstances( f, views, replaced,
+                    doc["nodes"][n]["extensions"]["EXT_mesh_gpu_instancing"]["attributes"], it->second );
+                continue;
+            }
+            const auto& [cx, cy, cz, s] = it->second;
+
+            rj::Value child( rj::kObjectType );
+            rj::Value translation( rj::kArrayType ), scale( rj::kArrayType );
+            translation.PushBack( cx, alloc ).PushBack( cy, alloc ).PushBack( cz, alloc );
+            scale.PushBack( s, alloc ).PushBack( s, alloc ).PushBack( s, alloc );
+            child.AddMember( "mesh", uint64_t( it->first ), alloc );
+            child.AddMember( "translation", translation, alloc );
+            child.AddMember( "scale", scale, alloc );
+            doc["nodes"].PushBack( child, alloc );
+
+            rj::Value& node = doc["nodes"][n];
+            node.RemoveMember( "mesh" );
+            if ( !node.HasMember( "children" ) )
+                node.AddMember( "children", rj::Value( rj::kArrayType ), alloc );
+            node["children"].PushBack( doc["nodes"].Size() - 1, alloc );
+        }
+    }
+
+    repackGltf( f, replaced, views );
+    if ( needsExtension )
+        requireExtension( doc, "KHR_mesh_quantization" );
+
+    return writeGltf( f, path );
+}
+
+} // namespace lodgen
+
@@ -0,0 +1,34 @@
+#pragma once
+#include "types.hpp"
+
+namespace lodgen
+{
+
+// Vertex quantization of exported glTF files (KHR_mesh_quantization).
+//
+// assimp always exports float32 attributes. quantizeGltf rewrites them in the
+// saved file and repacks its buffer without the float data:
+//   POSITION   int16 normalized within the mesh's bounds; a child node with
+//              the dequantizing (uniform) scale and offset takes the mesh, or
+//              the instances of an EXT_mesh_gpu_instancing node absorb them
+//   NORMAL     int8 or int16 normalized (normalBits)
+//   TANGENT    the same, w kept
+//   TEXCOORD   uint16 normalized, if every coordinate is within [0, 1]
+//   COLOR      uint8 normalized
+// Attributes that cannot be quantized that way stay float: positions of
+// skinned or morphed meshes, UVs outside [0, 1], and anything not stored as
+// plain float data.
+
+struct QuantizeOptions
+{
+    bool         positions  = true; // POSITION to int16 (adds a dequantizing node per mesh instance)
+    unsigned int normalBits = 8;    // NORMAL / TANGENT precision: 8 or 16
+};
+
+// True for outputs quantizeGltf can rewrite (.gltf with an external buffer, .glb).
+bool canQuantize( const fs::path& path );
+
+// Quantize the vertex attributes of the glTF file at `path` in place.
+VoidResult quantizeGltf( const fs::path& path, const QuantizeOptions& opts = {} );
+
+} // namespace lodgen
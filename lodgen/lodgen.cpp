@@ -1,12 +1,23 @@
 #include "lodgen.hpp"
+#include "budget.hpp"
+#include "cow_scene.hpp"
+#include "mesh_dedup.hpp"
 #include "mesh_simplifier.hpp"
 #include "scene_io.hpp"
+#include "stopwatch.hpp"
 #include "texture_atlas.hpp"
+#include <algorithm>
+#include <iterator>
+#include <limits>
+#include <mutex>
+#include <sstream>
 
 namespace lodgen
 {
 
-Result<ScenePtr> generateLod( const aiScene* scene, float ratio, const TextureOptions* texOpts )
+Result<ScenePtr> generateLod(
+    const aiScene* scene, float ratio, const TextureOptions* texOpts, ThreadPool* pool,
+    const SimplifyOptions& simplifyOpts )
 {
     aiScene* copy = nullptr;
     aiCopyScene( scene, &copy );
@@ -15,8 +26,9 @@ Result<ScenePtr> generateLod( const aiScene* scene, float ratio, const TextureOp
 
     ScenePtr result( copy );
 
-    for ( unsigned int i = 0; i < copy->mNumMeshes; ++i )
-        simplify( copy->mMeshes[i], ratio );
+    SimplifyOptions opts = simplifyOpts;
+    opts.contiguousFaces = true; // `result` hands the blocks back
+    simplifyScene( copy, ratio, pool, opts );
 
     if ( texOpts && texOpts->resizeTextures )
     {
@@ -28,16 +40,378 @@ Result<ScenePtr> generateLod( const aiScene* scene, float ratio, const TextureOp
     return result;
 }
 
-Result<std::vector<LodInfo>> generateLods(
+static float triangleRatio( const std::vector<SimplifyResult>& meshResults )
+{
+    uint64_t original = 0, simplified = 0;
+    for ( const auto& m : meshResults )
+    {
+        original   += m.originalTriangles;
+        simplified += m.simplifiedTriangles;
+    }
+    return original ? static_cast<float>( double( simplified ) / double( original ) ) : 1.0f;
+}
+
+float achievedRatio( const LodInfo& lod )
+{
+    return triangleRatio( lod.meshResults );
+}
+
+float achievedError( const LodInfo& lod )
+{
+    float error = 0;
+    for ( const auto& m : lod.meshResults )
+        error = std::max( error, m.accumulatedError );
+    return error;
+}
+
+// Entry `lod` of a per-LOD list, repeating the last one; `fallback` if empty.
+template <typename T>
+static T perLod( const std::vector<T>& values, size_t lod, T fallback )
+{
+    return values.empty() ? fallback : values[std::min( lod, values.size() - 1 )];
+}
+
+static LodBudget budgetFor( const LodOptions& lodOpts, size_t lod )
+{
+    return lod < lodOpts.budgets.size() ? lodOpts.budgets[lod] : LodBudget{};
+}
+
+// Simplifier options of LOD `lod`: the per-LOD lists over lodOpts.simplify.
+// A budgeted LOD must reach the ratios planned for it, so it has no error limit.
+static SimplifyOptions simplifyOptionsFor( const LodOptions& lodOpts, size_t lod )
+{
+    SimplifyOptions opts = lodOpts.simplify;
+    opts.engine   = perLod( lodOpts.lodEngines, lod, opts.engine );
+    opts.maxError = budgetFor( lodOpts, lod ).empty() ? perLod( lodOpts.maxErrors, lod, opts.maxError )
+                                                      : std::numeric_limits<float>::max();
+    opts.contiguousFaces = true; // LOD meshes are owned by a CowScene
+    return opts;
+}
+
+// Per-mesh ratios of every LOD: its ratio for every mesh, or the share of its
+// budget planned for each.
+static std::vector<std::vector<float>> lodMeshRatios(
+    const aiScene* scene, const std::vector<float>& ratios, const LodOptions& lodOpts,
+    const std::vector<unsigned int>& twins, ThreadPool* pool )
+{
+    std::optional<BudgetPlanner> planner;
+    std::vector<std::vector<float>> meshRatios;
+    for ( size_t i = 0; i < ratios.size(); ++i )
+    {
+        const LodBudget budget = budgetFor( lodOpts, i );
+        if ( budget.empty() )
+        {
+            meshRatios.emplace_back( scene->mNumMeshes, ratios[i] );
+            continue;
+        }
+        if ( !planner )
+            planner.emplace( scene, lodOpts.simplify, pool, twins );
+        meshRatios.push_back( planner->meshRatios( budget ) );
+    }
+    return meshRatios;
+}
+
+// `twins` (see findMeshTwins) restricted to meshes that also share their ratio
+// in `meshRatios`; the others are simplified on their own.
+static std::vector<unsigned int> twinsAtRatios( std::vector<unsigned int> twins, const std::vector<float>& meshRatios )
+{
+    for ( unsigned int m = 0; m < twins.size(); ++m )
+        if ( meshRatios[m] != meshRatios[twins[m]] )
+            twins[m] = m;
+    return twins;
+}
+
+// Deep-copy into `view` exactly what simplifyScene will modify: one mesh per
+// group of twins.
+static void detachForSimplify( CowScene& view, const std::vector<unsigned int>& twins )
+{
+    for ( unsigned int m = 0; m < view.get()->mNumMeshes; ++m )
+    {
+        const aiMesh* mesh = view.get()->mMeshes[m];
+        if ( twins[m] == m && ( canSimplify( mesh ) || canSimplifyPoints( mesh ) || canSimplifyLines( mesh ) ) )
+            view.mutableMesh( m );
+    }
+}
+
+// Point every twin at the simplified data of the mesh it was simplified with.
+static void shareTwins( CowScene& view, const std::vector<unsigned int>& twins )
+{
+    for ( unsigned int m = 0; m < twins.size(); ++m )
+        if ( twins[m] != m )
+            view.shareMesh( m, twins[m] );
+}
+
+// Deep-copy into `view` what processTextures will modify: embedded textures
+// and materials that reference any texture.
+static void detachForTextures( CowScene& view )
+{
+    const aiScene* sc = view.get();
+    for ( unsigned int t = 0; t < sc->mNumTextures; ++t )
+        view.mutableTexture( t );
+
+    for ( unsigned int m = 0; m < sc->mNumMaterials; ++m )
+        for ( aiTextureType type : kTextureTypes )
+            if ( sc->mMaterials[m]->GetTextureCount( type ) > 0 )
+            {
+                view.mutableMaterial( m );
+                break;
+            }
+}
+
+// Deep-copy into `view` what buildAtlas will modify: everything processTextures
+// touches, plus meshes with UVs (remapped into atlas space).
+static void detachForAtlas( CowScene& view )
+{
+    detachForTextures( view );
+    for ( unsigned int m = 0; m < view.get()->mNumMeshes; ++m )
+        if ( view.get()->mMeshes[m]->mTextureCoords[0] )
+            view.mutableMesh( m );
+}
+
+// Resize textures of an already simplified LOD scene, optionally atlas them,
+// save it and write its meshlet sidecar.
+static Result<LodInfo> finishLodFile(
+    CowScene& lodScene,
+    float ratio,
+    const fs::path& modelDir,
+    const fs::path& lodDir,
+    const fs::path& outPath,
+    const TextureOptions* texOpts,
+    TextureCache* texCache,
+    const LodOptions& lodOpts,
+    ThreadPool* pool,
+    std::vector<SimplifyResult> meshResults,
+    LodTimings timings )
+{
+    const FileSnapshot before = snapshotFiles( lodDir );
+    Stopwatch watch;
+
+    // Resized textures handed straight to the atlas stage instead of being
+    // written to lodDir and read back.
+    DecodedTextureMap resized;
+
+    std::optional<TextureStats> texStats;
+    if ( texOpts && texOpts->resizeTextures )
+    {
+        TextureOptions lodTexOpts = *texOpts;
+        lodTexOpts.outputDir = lodDir;
+        if ( lodOpts.atlas )
+        {
+            lodTexOpts.writeExternalFiles = false; // every slot ends up in an atlas
+            lodTexOpts.resized            = &resized;
+        }
+
+        watch.lap();
+        detachForTextures( lodScene );
+        timings.copy += watch.lap();
+
+        // Error-driven LODs have no nominal ratio; their textures follow the triangles.
+        const float texRatio = ratio > 0 ? ratio : triangleRatio( meshResults );
+        auto r = processTextures( lodScene.get(), texRatio, lodTexOpts, texCache );
+        if ( !r )
+            return std::unexpected( r.error() );
+        texStats = *r;
+        timings.textures = watch.lap();
+    }
+
+    std::vector<AtlasInfo> atlasInfos;
+    if ( lodOpts.atlas )
+    {
+        AtlasOptions atlasOpts;
+        atlasOpts.modelDir  = modelDir;
+        atlasOpts.outputDir = lodDir;
+        atlasOpts.decoded   = &resized;
+
+        watch.lap();
+        detachForAtlas( lodScene );
+        timings.copy += watch.lap();
+
+        auto r = buildAtlas( lodScene.get(), atlasOpts );
+        if ( !r )
+            return std::unexpected( r.error() );
+        atlasInfos = std::move( *r );
+        timings.atlas = watch.lap();
+    }
+
+    watch.lap();
+    auto saveResult = saveScene( lodScene.get(), outPath );
+    if ( !saveResult )
+        return std::unexpected( saveResult.error() );
+    std::optional<InstanceInfo> instancing;
+    if ( lodOpts.instance && canInstance( outPath ) )
+    {
+        auto r = instanceGltf( outPath );
+        if ( !r )
+            return std::unexpected( r.error() );
+        instancing = *r;
+    }
+    if ( lodOpts.quantize && canQuantize( outPath ) )
+    {
+        auto r = quantizeGltf( outPath, *lodOpts.quantize );
+        if ( !r )
+            return std::unexpected( r.error() );
+    }
+    std::optional<CompressInfo> compression;
+    if ( lodOpts.compress && canCompress( outPath ) )
+    {
+        auto r = compressGltf( outPath );
+        if ( !r )
+            return std::unexpected( r.error() );
+        compression = *r;
+    }
+    timings.save = watch.lap();
+
+    std::optional<MeshletInfo> meshlets;
+    if ( lodOpts.meshlets )
+    {
+        auto r = writeMeshlets( lodScene.get(), fs::path( outPath ).replace_extension( ".meshlets" ),
+                                *lodOpts.meshlets, pool );
+        if ( !r )
+            return std::unexpected( r.error() );
+        meshlets = std::move( *r );
+        timings.meshlets = watch.lap();
+    }
+
+    LodInfo info;
+    info.ratio        = ratio;
+    info.outputPath   = outPath;
+    info.textureStats = texStats;
+    info.meshResults  = std::move( meshResults );
+    info.atlasInfos   = std::move( atlasInfos );
+    info.meshlets     = std::move( meshlets );
+    info.compression  = compression;
+    info.instancing   = instancing;
+    info.timings      = timings;
+
+    std::error_code ec;
+    for ( const auto& f : filesChangedSince( lodDir, before ) )
+        info.bytesWritten += fs::file_size( lodDir / f, ec );
+
+    return info;
+}
+
+// One LOD job: copy-on-write view of the shared source, simplify, resize
+// textures, save. Only reads `scene`, so several of these may run concurrently.
+static Result<LodInfo> generateLodFile(
+    const aiScene* scene,
+    float ratio,
+    const std::vector<float>& meshRatios,
+    const fs::path& modelDir,
+    const fs::path& lodDir,
+    const fs::path& outPath,
+    const TextureOptions* texOpts,
+    TextureCache* texCache,
+    const LodOptions& lodOpts,
+    const SimplifyOptions& simplifyOpts,
+    const std::vector<unsigned int>& sourceTwins,
+    ThreadPool* pool )
+{
+    LodTimings timings;
+    Stopwatch  watch;
+
+    const auto twins = twinsAtRatios( sourceTwins, meshRatios );
+    CowScene lodScene( scene );
+    detachForSimplify( lodScene, twins );
+    timings.copy = watch.lap();
+
+    auto meshResults = simplifyScene( lodScene.get(), meshRatios, pool, simplifyOpts, twins );
+    shareTwins( lodScene, twins );
+    timings.simplify = watch.lap();
+
+    return finishLodFile( lodScene, ratio, modelDir, lodDir, outPath, texOpts, texCache, lodOpts, pool,
+                          std::move( meshResults ), timings );
+}
+
+// Cascaded chain: one working view of the source is simplified level by level,
+// each step aiming at the absolute target mesh ratio * source triangles from
+// what the previous level left. Every level is then viewed, textured and saved.
+// Materials and textures of the working view are never touched, so textures are
+// still resized from the source with the absolute ratio. Twins stay twins only
+// if they share their ratio at every level.
+static Result<std::vector<LodInfo>> generateLodChain(
     const aiScene* scene,
-    const fs::path& inputPath,
-    const fs::path& outputDir,
     const std::vector<float>& ratios,
-    const TextureOptions* texOpts )
+    const std::vector<std::vector<float>>& meshRatios,
+    const fs::path& modelDir,
+    const std::vector<fs::path>& lodDirs,
+    const std::vector<fs::path>& outPaths,
+    const TextureOptions* texOpts,
+    TextureCache* texCache,
+    const LodOptions& lodOpts,
+    const std::vector<unsigned int>& sourceTwins,
+    ThreadPool* pool )
 {
+    auto twins = sourceTwins;
+    for ( const auto& levelRatios : meshRatios )
+        twins = twinsAtRatios( std::move( twins ), levelRatios );
+
+    Stopwatch watch;
+    CowScene chain( scene );
+    detachForSimplify( chain, twins );
+    const double chainCopy = watch.lap(); // charged to the first level
+
+    const unsigned int meshCount = scene->mNumMeshes;
+    std::vector<SimplifyResult> prev( meshCount );
+    for ( unsigned int m = 0; m < meshCount; ++m )
+    {
+        prev[m].originalTriangles   = primitiveCount( scene->mMeshes[m] );
+        prev[m].simplifiedTriangles = prev[m].originalTriangles;
+        prev[m].originalVertices    = scene->mMeshes[m]->mNumVertices;
+    }
+
     std::vector<LodInfo> results;
     results.reserve( ratios.size() );
 
+    for ( size_t i = 0; i < ratios.size(); ++i )
+    {
+        std::vector<float> relative( meshCount, 1.0f );
+        for ( unsigned int m = 0; m < meshCount; ++m )
+        {
+            float target = prev[m].originalTriangles * meshRatios[i][m];
+            if ( prev[m].simplifiedTriangles > 0 )
+                relative[m] = std::clamp( target / prev[m].simplifiedTriangles, 0.0f, 1.0f );
+        }
+
+        LodTimings timings;
+        timings.copy = i == 0 ? chainCopy : 0.0;
+
+        watch.lap();
+        auto steps = simplifyScene( chain.get(), relative, pool, simplifyOptionsFor( lodOpts, i ), twins );
+        shareTwins( chain, twins );
+        timings.simplify = watch.lap();
+        for ( unsigned int m = 0; m < meshCount; ++m )
+        {
+            steps[m].originalTriangles = prev[m].originalTriangles;
+            steps[m].originalVertices  = prev[m].originalVertices;
+            steps[m].accumulatedError  = prev[m].accumulatedError + steps[m].error;
+        }
+        prev = steps;
+
+        // The level view borrows the chain's meshes; it is gone before the
+        // next level modifies them.
+        CowScene lodScene( chain.get() );
+        auto info = finishLodFile( lodScene, ratios[i], modelDir, lodDirs[i], outPaths[i], texOpts,
+                                   texCache, lodOpts, pool, std::move( steps ), timings );
+        if ( !info )
+            return std::unexpected( info.error() );
+        results.push_back( std::move( *info ) );
+    }
+
+    return results;
+}
+
+Result<std::vector<LodInfo>> generateLods(
+    const aiScene* scene,
+    const fs::path& inputPath,
+    const fs::path& outputDir,
+    const std::vector<float>& ratios,
+    const TextureOptions* texOpts,
+    const LodOptions& lodOpts )
+{
+    // Directories are created up front so concurrent jobs never race on the
+    // shared parent.
+    std::vector<fs::path> lodDirs;
+    std::vector<fs::path> outPaths;
     for ( size_t i = 0; i < ratios.size(); ++i )
     {
         const auto lodPostfix = "lod" + std::to_string( i + 1 );
@@ -50,69 +424,505 @@ Result<std::vector<LodInfo>> generateLods(
             return std::unexpected( Error{ ErrorCode::ExportFailed,
                 "Could not create directory " + lodDir.string() + ": " + ec.message() } );
 
-        aiScene* copy = nullptr;
-        aiCopyScene( scene, &copy );
-        if ( !copy )
-            return std::unexpected( Error{ ErrorCode::SceneCopyFailed, "aiCopyScene failed" } );
-        ScenePtr lodScene( copy );
+        lodDirs.push_back( std::move( lodDir ) );
+        outPaths.push_back( std::move( outPath ) );
+    }
 
-        for ( unsigned int m = 0; m < copy->mNumMeshes; ++m )
-            simplify( copy->mMeshes[m], ratios[i] );
+    std::optional<ThreadPool> ownPool;
+    ThreadPool* pool = lodOpts.pool;
+    if ( !pool )
+        pool = &ownPool.emplace( lodOpts.workers );
 
-        std::optional<TextureStats> texStats;
-        if ( texOpts && texOpts->resizeTextures )
-        {
-            TextureOptions lodTexOpts = *texOpts;
-            lodTexOpts.outputDir = lodDir;
+    // Every texture is decoded once for the whole call, not once per ratio.
+    // Error-driven levels (ratio 0) resize from the source at their achieved ratio.
+    std::vector<float> texRatios;
+    std::copy_if( ratios.begin(), ratios.end(), std::back_inserter( texRatios ), []( float r ) { return r > 0; } );
+    TextureCache texCache( std::move( texRatios ) );
 
-            auto r = processTextures( copy, ratios[i], lodTexOpts );
-            if ( !r )
-                return std::unexpected( r.error() );
-            texStats = *r;
+    const fs::path modelDir = inputPath.parent_path();
+    const auto twins      = findMeshTwins( scene, pool );
+    const auto meshRatios = lodMeshRatios( scene, ratios, lodOpts, twins, pool );
+
+    if ( lodOpts.cascade )
+        return generateLodChain( scene, ratios, meshRatios, modelDir, lodDirs, outPaths, texOpts, &texCache,
+                                 lodOpts, twins, pool );
+
+    std::vector<Result<LodInfo>> lods( ratios.size() );
+    pool->parallelFor( ratios.size(), [&]( size_t i ) {
+        lods[i] = generateLodFile( scene, ratios[i], meshRatios[i], modelDir, lodDirs[i], outPaths[i], texOpts,
+                                   &texCache, lodOpts, simplifyOptionsFor( lodOpts, i ), twins, pool );
+    } );
+
+    std::vector<LodInfo> results;
+    results.reserve( ratios.size() );
+    for ( auto& lod : lods )
+    {
+        if ( !lod )
+            return std::unexpected( lod.error() );
+        results.push_back( std::move( *lod ) );
+    }
+
+    return results;
+}
+
+// ── build cache ───────────────────────────────────────────────────────────────
+//
+// Record text stored with each entry, one item per line:
+//   lod <ratio> <output path relative to outputDir>
+//   bytes <bytes written>                                      (of the last lod)
+//   mesh <original tris> <simplified tris> <error> <accumulated error>
+//        <original vertices> <simplified vertices>
+//        <target tris> <engine>                                (of the last lod)
+//   tex <input> <output> <atlas w> <atlas h>                   (of the last lod)
+//   atlas <type> <inputs> <w> <h> <filename>   (of the last lod, or top-level before any lod)
+//   meshlets <count> <path relative to outputDir>              (of the last lod)
+//   compressed <raw bytes> <compressed bytes> <streams>        (of the last lod)
+//   instanced <meshes merged> <instanced nodes> <instances>    (of the last lod)
+//   removed <path relative to outputDir>       (deleted by the build; deleted again on restore)
+
+struct CacheRecord
+{
+    std::vector<LodInfo>   lods;
+    std::vector<AtlasInfo> atlases;
+    std::vector<fs::path>  removed;
+};
+
+static std::string writeRecord( const CacheRecord& rec, const fs::path& outputDir )
+{
+    std::ostringstream out;
+    out.precision( std::numeric_limits<float>::max_digits10 );
+
+    auto writeAtlas = [&]( const AtlasInfo& a ) {
+        out << "atlas " << static_cast<int>( a.type ) << ' ' << a.inputCount << ' '
+            << a.width << ' ' << a.height << ' ' << a.filename << '\n';
+    };
+
+    for ( const auto& a : rec.atlases )
+        writeAtlas( a );
+    for ( const auto& lod : rec.lods )
+    {
+        out << "lod " << lod.ratio << ' '
+            << fs::relative( lod.outputPath, outputDir ).generic_string() << '\n';
+        out << "bytes " << lod.bytesWritten << '\n';
+        for ( const auto& m : lod.meshResults )
+            out << "mesh " << m.originalTriangles << ' ' << m.simplifiedTriangles << ' '
+                << m.error << ' ' << m.accumulatedError << ' '
+                << m.originalVertices << ' ' << m.simplifiedVertices << ' '
+                << m.targetTriangles << ' ' << static_cast<int>( m.engine ) << '\n';
+        if ( lod.textureStats )
+            out << "tex " << lod.textureStats->inputCount << ' ' << lod.textureStats->outputCount << ' '
+                << lod.textureStats->atlasWidth << ' ' << lod.textureStats->atlasHeight << '\n';
+        for ( const auto& a : lod.atlasInfos )
+            writeAtlas( a );
+        if ( lod.meshlets )
+            out << "meshlets " << lod.meshlets->meshletCount << ' '
+                << fs::relative( lod.meshlets->path, outputDir ).generic_string() << '\n';
+        if ( lod.compression )
+            out << "compressed " << lod.compression->rawBytes << ' ' << lod.compression->compressedBytes << ' '
+                << lod.compression->streams << '\n';
+        if ( lod.instancing )
+            out << "instanced " << lod.instancing->meshesMerged << ' ' << lod.instancing->instancedNodes << ' '
+                << lod.instancing->instances << '\n';
+    }
+    for ( const auto& r : rec.removed )
+        out << "removed " << r.generic_string() << '\n';
+    return out.str();
+}
+
+static std::optional<CacheRecord> readRecord( const std::string& text, const fs::path& outputDir )
+{
+    CacheRecord rec;
+    std::istringstream in( text );
+    std::string line;
+    while ( std::getline( in, line ) )
+    {
+        std::istringstream fields( line );
+        std::string tag;
+        fields >> tag;
+
+        // Trailing path / name field, may contain spaces.
+        auto rest = [&] {
+            std::string r;
+            std::getline( fields >> std::ws, r );
+            return r;
+        };
+
+        if ( tag == "lod" )
+        {
+            LodInfo lod;
+            fields >> lod.ratio;
+            lod.outputPath = outputDir / rest();
+            lod.fromCache  = true;
+            rec.lods.push_back( std::move( lod ) );
+        }
+        else if ( tag == "bytes" && !rec.lods.empty() )
+        {
+            fields >> rec.lods.back().bytesWritten;
+        }
+        else if ( tag == "mesh" && !rec.lods.empty() )
+        {
+            SimplifyResult m{};
+            int engine = 0;
+            fields >> m.originalTriangles >> m.simplifiedTriangles >> m.error >> m.accumulatedError
+                   >> m.originalVertices >> m.simplifiedVertices >> m.targetTriangles >> engine;
+            m.engine = static_cast<SimplifyEngine>( engine );
+            rec.lods.back().meshResults.push_back( m );
+        }
+        else if ( tag == "tex" && !rec.lods.empty() )
+        {
+            TextureStats t;
+            fields >> t.inputCount >> t.outputCount >> t.atlasWidth >> t.atlasHeight;
+            rec.lods.back().textureStats = t;
         }
+        else if ( tag == "atlas" )
+        {
+            AtlasInfo a{};
+            int type = 0;
+            fields >> type >> a.inputCount >> a.width >> a.height;
+            a.type     = static_cast<aiTextureType>( type );
+            a.filename = rest();
+            ( rec.lods.empty() ? rec.atlases : rec.lods.back().atlasInfos ).push_back( std::move( a ) );
+        }
+        else if ( tag == "meshlets" && !rec.lods.empty() )
+        {
+            MeshletInfo m;
+            fields >> m.meshletCount;
+            m.path = outputDir / rest();
+            rec.lods.back().meshlets = std::move( m );
+        }
+        else if ( tag == "compressed" && !rec.lods.empty() )
+        {
+            CompressInfo c;
+            fields >> c.rawBytes >> c.compressedBytes >> c.streams;
+            rec.lods.back().compression = c;
+        }
+        else if ( tag == "instanced" && !rec.lods.empty() )
+        {
+            InstanceInfo i;
+            fields >> i.meshesMerged >> i.instancedNodes >> i.instances;
+            rec.lods.back().instancing = i;
+        }
+        else if ( tag == "removed" )
+        {
+            rec.removed.push_back( rest() );
+        }
+        else
+        {
+            return std::nullopt;
+        }
+
+        if ( fields.fail() )
+            return std::nullopt;
+    }
+    return rec;
+}
+
+// Every external texture path a material of `scene` could be read from,
+// following the lookups of processTextures and buildAtlas.
+static std::vector<fs::path> textureCandidates( const aiScene* scene, const std::vector<fs::path>& dirs )
+{
+    std::vector<fs::path> paths;
+    for ( unsigned int m = 0; m < scene->mNumMaterials; ++m )
+        for ( aiTextureType type : kTextureTypes )
+            for ( unsigned int slot = 0; slot < scene->mMaterials[m]->GetTextureCount( type ); ++slot )
+            {
+                aiString raw;
+                scene->mMaterials[m]->GetTexture( type, slot, &raw );
+                if ( raw.length == 0 || raw.data[0] == '*' )
+                    continue;
+                for ( const auto& dir : dirs )
+                {
+                    paths.push_back( ( dir / raw.C_Str() ).lexically_normal() );
+                    paths.push_back( ( dir / fs::path( raw.C_Str() ).filename() ).lexically_normal() );
+                }
+            }
+    return paths;
+}
+
+// Dependencies of a build rooted at baseDir: `files` other than `primary`
+// (already part of the key), deduplicated, relative to baseDir.
+static std::vector<CacheDependency> buildDependencies(
+    const fs::path& baseDir, const fs::path& primary, const std::vector<fs::path>& files )
+{
+    std::error_code ec;
+    const fs::path primaryAbs = fs::weakly_canonical( primary, ec );
+
+    std::vector<fs::path> rel;
+    for ( const auto& f : files )
+    {
+        if ( fs::weakly_canonical( f, ec ) == primaryAbs )
+            continue;
+        fs::path r = fs::relative( f, baseDir, ec );
+        if ( ec || r.empty() )
+            r = fs::absolute( f, ec );
+        if ( std::find( rel.begin(), rel.end(), r ) == rel.end() )
+            rel.push_back( std::move( r ) );
+    }
+    return hashDependencies( baseDir, rel );
+}
+
+// Files below each of `dirs` (relative to outputDir) changed or removed since
+// `before`, the snapshot of all of them.
+static void collectOutputs(
+    const fs::path& outputDir, const std::vector<fs::path>& dirs,
+    const std::vector<FileSnapshot>& before,
+    std::vector<fs::path>& written, std::vector<fs::path>& removed )
+{
+    for ( size_t i = 0; i < dirs.size(); ++i )
+    {
+        const fs::path prefix = fs::relative( dirs[i], outputDir );
+        for ( const auto& f : filesChangedSince( dirs[i], before[i] ) )
+            written.push_back( ( prefix / f ).lexically_normal() );
+
+        std::error_code ec;
+        for ( const auto& [f, time] : before[i] )
+            if ( !fs::exists( dirs[i] / f, ec ) )
+                removed.push_back( ( prefix / f ).lexically_normal() );
+    }
+}
 
-        auto saveResult = saveScene( lodScene.get(), outPath );
-        if ( !saveResult )
-            return std::unexpected( saveResult.error() );
+static void applyRemoved( const fs::path& outputDir, const std::vector<fs::path>& removed )
+{
+    std::error_code ec;
+    for ( const auto& r : removed )
+        fs::remove( outputDir / r, ec );
+}
+
+Result<std::vector<LodInfo>> generateLodsFromFile(
+    const fs::path& inputPath,
+    const fs::path& outputDir,
+    const std::vector<float>& ratios,
+    const TextureOptions* texOpts,
+    const LodOptions& lodOpts )
+{
+    std::optional<TextureOptions> modelTexOpts;
+    if ( texOpts )
+    {
+        modelTexOpts = *texOpts;
+        modelTexOpts->modelDir = inputPath.parent_path();
+    }
+    const TextureOptions* modelTex = modelTexOpts ? &*modelTexOpts : nullptr;
+
+    if ( !lodOpts.cache )
+    {
+        auto scene = loadScene( inputPath );
+        if ( !scene )
+            return std::unexpected( scene.error() );
+        return generateLods( scene->get(), inputPath, outputDir, ratios, modelTex, lodOpts );
+    }
 
-        LodInfo info;
-        info.ratio        = ratios[i];
-        info.outputPath   = outPath;
-        info.textureStats = texStats;
+    const fs::path modelDir = inputPath.parent_path();
+
+    ContentHash key;
+    if ( !key.addFile( inputPath ) )
+        return std::unexpected( Error{ ErrorCode::FileNotFound, "File not found: " + inputPath.string() } );
+    key.add( kOutputVersion );
+    key.add( std::string_view( "lods" ) );
+    key.add( inputPath.filename().string() );
+    key.add( ratios.size() );
+    for ( float r : ratios )
+        key.add( r );
+    key.add( modelTex && modelTex->resizeTextures );
+    key.add( lodOpts.cascade );
+    key.add( lodOpts.atlas );
+    for ( size_t i = 0; i < ratios.size(); ++i )
+    {
+        const SimplifyOptions opts = simplifyOptionsFor( lodOpts, i );
+        key.add( static_cast<int>( opts.engine ) );
+        key.add( opts.maxError );
+    }
+    key.add( lodOpts.simplify.sloppyTriangles );
+    key.add( lodOpts.simplify.absoluteError );
+    key.add( lodOpts.simplify.chunkTriangles );
+    key.add( static_cast<int>( lodOpts.simplify.seams ) );
+    key.add( lodOpts.simplify.pointColorWeight );
+    key.add( lodOpts.meshlets.has_value() );
+    if ( lodOpts.meshlets )
+    {
+        key.add( lodOpts.meshlets->maxVertices );
+        key.add( lodOpts.meshlets->maxTriangles );
+        key.add( lodOpts.meshlets->spatial );
+        key.add( lodOpts.meshlets->coneWeight );
+    }
+    key.add( lodOpts.instance );
+    key.add( lodOpts.quantize.has_value() );
+    if ( lodOpts.quantize )
+    {
+        key.add( lodOpts.quantize->positions );
+        key.add( lodOpts.quantize->normalBits );
+    }
+    key.add( lodOpts.compress );
+    for ( size_t i = 0; i < ratios.size(); ++i )
+    {
+        key.add( budgetFor( lodOpts, i ).triangles );
+        key.add( budgetFor( lodOpts, i ).bytes );
+    }
 
-        for ( unsigned int m = 0; m < copy->mNumMeshes; ++m )
+    if ( auto text = lodOpts.cache->restore( key.value(), modelDir, outputDir ) )
+    {
+        if ( auto rec = readRecord( *text, outputDir ) )
         {
-            SimplifyResult meshResult{};
-            meshResult.simplifiedTriangles = copy->mMeshes[m]->mNumFaces;
-            info.meshResults.push_back( meshResult );
+            applyRemoved( outputDir, rec->removed );
+            return std::move( rec->lods );
         }
+    }
+
+    std::vector<fs::path> readFiles;
+    auto scene = loadScene( inputPath, &readFiles );
+    if ( !scene )
+        return std::unexpected( scene.error() );
 
-        results.push_back( std::move( info ) );
+    for ( auto& t : textureCandidates( scene->get(), { modelDir } ) )
+        readFiles.push_back( std::move( t ) );
+    auto deps = buildDependencies( modelDir, inputPath, readFiles );
+
+    // generateLods names them the same way.
+    std::vector<fs::path> lodDirs;
+    std::vector<FileSnapshot> before;
+    for ( size_t i = 0; i < ratios.size(); ++i )
+    {
+        lodDirs.push_back( outputDir / ( "lod" + std::to_string( i + 1 ) ) );
+        detachRestoredFiles( lodDirs.back() );
+        before.push_back( snapshotFiles( lodDirs.back() ) );
     }
 
+    auto lods = generateLods( scene->get(), inputPath, outputDir, ratios, modelTex, lodOpts );
+    if ( !lods )
+        return lods;
+
+    CacheRecord rec;
+    rec.lods = *lods;
+    std::vector<fs::path> written;
+    collectOutputs( outputDir, lodDirs, before, written, rec.removed );
+
+    // A cache that cannot be written only costs the next run its time.
+    (void)lodOpts.cache->store( key.value(), deps, outputDir, written, writeRecord( rec, outputDir ) );
+
+    return lods;
+}
+
+std::vector<BatchResult> generateLodsBatch(
+    const std::vector<BatchJob>& jobs,
+    const std::vector<float>& ratios,
+    const TextureOptions* texOpts,
+    const LodOptions& lodOpts,
+    const std::function<void( const BatchResult& )>& onDone )
+{
+    std::optional<ThreadPool> ownPool;
+    LodOptions modelOpts = lodOpts;
+    if ( !modelOpts.pool )
+        modelOpts.pool = &ownPool.emplace( lodOpts.workers );
+
+    // Largest files first, so the long tail is made of small models.
+    std::vector<uintmax_t> sizes( jobs.size(), 0 );
+    for ( size_t i = 0; i < jobs.size(); ++i )
+    {
+        std::error_code ec;
+        uintmax_t size = fs::file_size( jobs[i].inputPath, ec );
+        sizes[i] = ec ? 0 : size;
+    }
+    std::vector<size_t> order( jobs.size() );
+    for ( size_t i = 0; i < order.size(); ++i )
+        order[i] = i;
+    std::stable_sort( order.begin(), order.end(),
+                      [&]( size_t a, size_t b ) { return sizes[a] > sizes[b]; } );
+
+    std::vector<BatchResult> results( jobs.size() );
+    std::mutex doneMutex;
+
+    modelOpts.pool->parallelFor( order.size(), [&]( size_t k ) {
+        const BatchJob& job    = jobs[order[k]];
+        BatchResult&    result = results[order[k]];
+        result.inputPath = job.inputPath;
+
+        result.lods = generateLodsFromFile( job.inputPath, job.outputDir, ratios, texOpts, modelOpts );
+
+        if ( onDone )
+        {
+            std::lock_guard lock( doneMutex );
+            onDone( result );
+        }
+    } );
+
     return results;
 }
 
 Result<std::vector<AtlasInfo>> buildLodAtlas(
     const fs::path& modelPath,
-    const AtlasOptions& opts )
+    const AtlasOptions& opts,
+    BuildCache* cache )
 {
+    const fs::path modelDir = modelPath.parent_path();
+
+    ContentHash key;
+    if ( cache )
+    {
+        key.addFile( modelPath );
+        key.add( kOutputVersion );
+        key.add( std::string_view( "atlas" ) );
+        key.add( modelPath.filename().string() );
+        // Where textures are looked up and atlases written, as seen from the
+        // model: restore puts files back at the same relative paths.
+        for ( const fs::path* dir : { &opts.outputDir, &opts.modelDir } )
+        {
+            std::error_code ec;
+            fs::path rel = dir->empty() ? fs::path() : fs::relative( *dir, modelDir, ec );
+            if ( ec )
+                rel = fs::absolute( *dir, ec );
+            key.add( rel.lexically_normal().generic_string() );
+        }
+
+        if ( auto text = cache->restore( key.value(), modelDir, modelDir ) )
+        {
+            if ( auto rec = readRecord( *text, modelDir ) )
+            {
+                applyRemoved( modelDir, rec->removed );
+                return std::move( rec->atlases );
+            }
+        }
+    }
+
     // Load the saved LOD model as a mutable copy
-    auto sceneResult = loadSceneMutable( modelPath );
+    std::vector<fs::path> readFiles;
+    auto sceneResult = loadSceneMutable( modelPath, cache ? &readFiles : nullptr );
     if ( !sceneResult )
         return std::unexpected( sceneResult.error() );
 
     aiScene* scene = sceneResult->get();
 
+    // Dependencies are hashed now: buildAtlas removes the textures it bakes.
+    std::vector<CacheDependency> deps;
+    FileSnapshot before;
+    if ( cache )
+    {
+        for ( auto& t : textureCandidates( scene, { opts.outputDir, opts.modelDir } ) )
+            readFiles.push_back( std::move( t ) );
+        deps = buildDependencies( modelDir, modelPath, readFiles );
+
+        detachRestoredFiles( modelDir );
+        before = snapshotFiles( modelDir );
+    }
+
     auto atlasResult = buildAtlas( scene, opts );
     if ( !atlasResult )
         return std::unexpected( atlasResult.error() );
 
     // Re-save model with updated material paths and embedded atlases
-    auto saveResult = saveScene( scene, modelPath );
+    // The reloaded scene is not needed afterwards, so its unused materials are
+    // stripped in place; assimp still exports from its own deep copy.
+    auto saveResult = saveScene( std::move( *sceneResult ), modelPath );
     if ( !saveResult )
         return std::unexpected( saveResult.error() );
 
+    if ( cache )
+    {
+        CacheRecord rec;
+        rec.atlases = *atlasResult;
+        std::vector<fs::path> written;
+        collectOutputs( modelDir, { modelDir }, { before }, written, rec.removed );
+        (void)cache->store( key.value(), deps, modelDir, written, writeRecord( rec, modelDir ) );
+    }
+
     return atlasResult;
 }
 
@@ -1,44 +1,177 @@
 #pragma once
 #include "types.hpp"
+#include "budget.hpp"
+#include "build_cache.hpp"
+#include "cluster_lod.hpp"
+#include "gltf_compress.hpp"
+#include "gltf_instancing.hpp"
+#include "gltf_quantize.hpp"
 #include "mesh_simplifier.hpp"
+#include "meshlets.hpp"
 #include "texture_processor.hpp"
 #include "texture_atlas.hpp"
+#include "thread_pool.hpp"
+#include <functional>
 #include <optional>
 #include <vector>
 
 namespace lodgen
 {
 
+// Wall-clock seconds per stage of one LOD. In a cascade, the simplify and copy
+// of a level only cover its own step.
+struct LodTimings
+{
+    double copy     = 0; // copy-on-write detaches of meshes, materials and textures
+    double simplify = 0; // simplifyScene, meshes possibly in parallel
+    double textures = 0; // processTextures (see TextureStats for the breakdown)
+    double atlas    = 0;
+    double save     = 0; // export, including material cleanup, instancing, quantization and compression
+    double meshlets = 0; // meshlet sidecar, if written
+};
+
 struct LodInfo
 {
     float ratio;
     fs::path outputPath;
     std::vector<SimplifyResult>  meshResults;
     std::optional<TextureStats>  textureStats; // set if processTextures ran
-    std::vector<AtlasInfo>       atlasInfos;   // set if buildLodAtlas ran
+    std::vector<AtlasInfo>       atlasInfos;   // set if the atlas stage ran
+    std::optional<MeshletInfo>   meshlets;     // set if the meshlet sidecar was written
+    std::optional<CompressInfo>  compression;  // set if the LOD file was compressed
+    std::optional<InstanceInfo>  instancing;   // set if the instancing pass ran on the LOD file
+    LodTimings                   timings;      // all zero when restored from a cache
+    uint64_t                     bytesWritten = 0; // files written into the LOD directory
+    bool                         fromCache    = false;
+};
+
+// Simplified / original triangles over all meshes of a LOD, to compare with
+// the requested ratio (1 for a LOD without triangles).
+float achievedRatio( const LodInfo& lod );
+
+// Largest accumulated simplification error over the meshes of a LOD, in the
+// units of LodOptions::simplify.absoluteError.
+float achievedError( const LodInfo& lod );
+
+struct LodOptions
+{
+    unsigned int workers = 1;       // threads for LODs and their meshes; 0 = hardware concurrency
+    ThreadPool*  pool    = nullptr; // shared pool to run on; overrides workers when set
+    bool         cascade = false;   // simplify each LOD from the previous one, not the source
+    bool         atlas   = false;   // build texture atlases in memory before each LOD is saved
+    BuildCache*  cache   = nullptr; // restore outputs of an identical earlier build (file-based entry points)
+
+    SimplifyOptions             simplify;   // engine, Auto threshold and error limit for every LOD
+    std::vector<SimplifyEngine> lodEngines; // per ratio, overriding simplify.engine; shorter lists repeat the last entry
+    std::vector<float>          maxErrors;  // per ratio, overriding simplify.maxError; same repetition
+    std::vector<LodBudget>      budgets;    // per ratio (missing = none); replaces the ratio for the meshes
+
+    std::optional<MeshletOptions> meshlets; // write <LOD file stem>.meshlets next to every LOD (see meshlets.hpp)
+    bool instance = false; // merge identical glTF / GLB meshes and instance them (EXT_mesh_gpu_instancing, see gltf_instancing.hpp)
+    std::optional<QuantizeOptions> quantize; // quantize the vertex attributes of glTF / GLB LODs (see gltf_quantize.hpp)
+    bool compress = false; // EXT_meshopt_compression for glTF / GLB LODs, after quantize (see gltf_compress.hpp)
 };
 
 // Generate a single LOD scene in memory (no disk I/O).
+// With a pool, meshes are simplified concurrently.
 Result<ScenePtr> generateLod(
     const aiScene* scene,
     float ratio,
-    const TextureOptions* texOpts = nullptr );
+    const TextureOptions* texOpts = nullptr,
+    ThreadPool* pool = nullptr,
+    const SimplifyOptions& simplifyOpts = {} );
 
 // Generate multiple LODs, save each to outputDir/lod{1..n}/{stem}lod{n}{ext}.
-// Mesh simplification and optional texture resize only — atlas is a separate step.
+// Mesh simplification, optional texture resize and, with lodOpts.atlas, an
+// in-memory atlas stage that runs on the simplified scene before its single save.
+// Each ratio is copied, simplified, resized and saved as an independent job; with
+// more than one worker the jobs, and the meshes within each job, run concurrently.
+// Results are in ratio order and the first failing ratio (in that order) is
+// returned as the error.
+//
+// With lodOpts.cascade, LOD n+1 is simplified from LOD n's meshes towards the
+// same absolute triangle target instead of from the source. Ratios should then
+// be descending; LODs run one after another, meshes still in parallel.
+//
+// Error-driven LODs: a ratio of 0 with an error limit in lodOpts.maxErrors
+// lets each mesh drop as many triangles as that error allows. Textures of such
+// a LOD are scaled by its achieved ratio. In a cascade the limit applies to
+// each step, so the accumulated error can exceed it.
+//
+// A LOD with a budget in lodOpts.budgets splits it across the meshes with a
+// BudgetPlanner (the lowest maximum error that fits) instead of using its
+// ratio for every mesh; give it ratio 0 to scale its textures by the result.
+//
+// With lodOpts.meshlets, every saved LOD also gets a meshlet sidecar built
+// from its final meshes. With lodOpts.instance, glTF / GLB LODs get their
+// repeated meshes merged and instanced after the save; with lodOpts.quantize
+// they are then rewritten with quantized vertex attributes, and with
+// lodOpts.compress their buffers are meshopt-compressed; other formats are left
+// as is.
+//
+// Meshes with identical geometry (see findMeshTwins) are simplified once per
+// LOD wherever they get the same ratio, and share the result.
 Result<std::vector<LodInfo>> generateLods(
     const aiScene* scene,
     const fs::path& inputPath,
     const fs::path& outputDir,
     const std::vector<float>& ratios,
-    const TextureOptions* texOpts = nullptr );
+    const TextureOptions* texOpts = nullptr,
+    const LodOptions& lodOpts = {} );
+
+// Load inputPath and generateLods for it; texOpts->modelDir is replaced by the
+// model's directory.
+//
+// With lodOpts.cache, the model file, its name, the ratios and options are
+// hashed before anything is imported. If the cache has outputs for that key
+// and every file they were built from (whatever the importer read, e.g. .mtl
+// or .bin, and the referenced textures) is unchanged, those outputs are
+// hard-linked into outputDir and their LodInfos returned without importing.
+// Otherwise the LODs are generated and stored in the cache.
+Result<std::vector<LodInfo>> generateLodsFromFile(
+    const fs::path& inputPath,
+    const fs::path& outputDir,
+    const std::vector<float>& ratios,
+    const TextureOptions* texOpts = nullptr,
+    const LodOptions& lodOpts = {} );
+
+struct BatchJob
+{
+    fs::path inputPath;
+    fs::path outputDir;     // receives lod{1..n}/ for this model
+};
+
+struct BatchResult
+{
+    fs::path                     inputPath;
+    Result<std::vector<LodInfo>> lods;  // error if loading or any LOD of this model failed
+};
+
+// generateLodsFromFile for many models in one process. Models, their LODs,
+// meshes and textures all share one pool (lodOpts.pool or an own one of
+// lodOpts.workers threads), so a few large models cannot leave threads idle.
+// Models are started largest input file first.
+//
+// A failing model does not stop the batch: its error is returned in its entry.
+// Results are in job order. onDone, if set, is called as each model finishes,
+// one call at a time, from whichever thread finished it.
+std::vector<BatchResult> generateLodsBatch(
+    const std::vector<BatchJob>& jobs,
+    const std::vector<float>& ratios,
+    const TextureOptions* texOpts = nullptr,
+    const LodOptions& lodOpts = {},
+    const std::function<void( const BatchResult& )>& onDone = {} );
 
-// Build per-type PNG atlases for a single saved LOD model.
+// Build per-type PNG atlases for a single saved LOD model (two-pass path).
 // Call after generateLods — modelPath is the saved .glb/.fbx/etc. file.
+// Prefer LodOptions::atlas, which skips the reload and second export.
 // Reads textures from modelDir (originals) or outputDir (resized copies),
 // builds atlas_<type>.png per type, updates model materials, re-saves.
+// With a cache, an identical earlier run (same model bytes, same textures)
+// is restored instead, as for generateLodsFromFile.
 Result<std::vector<AtlasInfo>> buildLodAtlas(
     const fs::path& modelPath,
-    const AtlasOptions& opts );
+    const AtlasOptions& opts,
+    BuildCache* cache = nullptr );
 
 } // namespace lodgen
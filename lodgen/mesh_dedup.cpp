@@ -0,0 +1,125 @@
+#include "mesh_dedup.hpp"
+#include "build_cache.hpp"
+#include <cstring>
+#include <unordered_map>
+
+namespace lodgen
+{
+
+static bool canShare( const aiMesh* mesh )
+{
+    return mesh && mesh->mNumVertices > 0 && mesh->mNumBones == 0 && mesh->mNumAnimMeshes == 0;
+}
+
+// Calls fn( data, size ) for every stream of `mesh` in a fixed order; absent
+// streams pass a null pointer, so layouts never compare equal by accident.
+template <typename Fn>
+static void forEachStream( const aiMesh* mesh, Fn&& fn )
+{
+    const size_t n = mesh->mNumVertices;
+    auto stream = [&]( const void* data, size_t elementSize ) { fn( data, data ? n * elementSize : 0 ); };
+
+    stream( mesh->mVertices, sizeof( aiVector3D ) );
+    stream( mesh->mNormals, sizeof( aiVector3D ) );
+    stream( mesh->mTangents, sizeof( aiVector3D ) );
+    stream( mesh->mBitangents, sizeof( aiVector3D ) );
+    for ( unsigned int ch = 0; ch < AI_MAX_NUMBER_OF_TEXTURECOORDS; ++ch )
+    {
+        stream( mesh->mTextureCoords[ch], sizeof( aiVector3D ) );
+        fn( &mesh->mNumUVComponents[ch], sizeof( unsigned int ) );
+    }
+    for ( unsigned int ch = 0; ch < AI_MAX_NUMBER_OF_COLOR_SETS; ++ch )
+        stream( mesh->mColors[ch], sizeof( aiColor4D ) );
+}
+
+static uint64_t meshHash( const aiMesh* mesh )
+{
+    ContentHash h;
+    h.add( mesh->mPrimitiveTypes );
+    h.add( mesh->mNumVertices );
+    h.add( mesh->mNumFaces );
+    forEachStream( mesh, [&]( const void* data, size_t size ) {
+        h.add( data != nullptr );
+        if ( data )
+            h.add( data, size );
+    } );
+    for ( unsigned int f = 0; f < mesh->mNumFaces; ++f )
+    {
+        const aiFace& face = mesh->mFaces[f];
+        h.add( face.mNumIndices );
+        h.add( face.mIndices, face.mNumIndices * sizeof( unsigned int ) );
+    }
+    return h.value();
+}
+
+static bool sameGeometry( const aiMesh* a, const aiMesh* b )
+{
+    if ( a->mPrimitiveTypes != b->mPrimitiveTypes || a->mNumVertices != b->mNumVertices ||
+         a->mNumFaces != b->mNumFaces )
+        return false;
+
+    std::vector<std::pair<const void*, size_t>> streams;
+    forEachStream( a, [&]( const void* data, size_t size ) { streams.emplace_back( data, size ); } );
+    size_t s = 0;
+    bool same = true;
+    forEachStream( b, [&]( const void* data, size_t size ) {
+        const auto& [other, otherSize] = streams[s++];
+        same = same && ( data != nullptr ) == ( other != nullptr ) && size == otherSize &&
+               ( !data || data == other || std::memcmp( data, other, size ) == 0 );
+    } );
+
+    for ( unsigned int f = 0; f < a->mNumFaces && same; ++f )
+    {
+        const aiFace& fa = a->mFaces[f];
+        const aiFace& fb = b->mFaces[f];
+        same = fa.mNumIndices == fb.mNumIndices &&
+               std::memcmp( fa.mIndices, fb.mIndices, fa.mNumIndices * sizeof( unsigned int ) ) == 0;
+    }
+    return same;
+}
+
+std::vector<unsigned int> findMeshTwins( const aiScene* scene, ThreadPool* pool )
+{
+    const unsigned int meshCount = scene->mNumMeshes;
+    std::vector<unsigned int> twins( meshCount );
+    std::vector<uint64_t>     hashes( meshCount, 0 );
+
+    auto hashMesh = [&]( size_t m ) {
+        if ( canShare( scene->mMeshes[m] ) )
+            hashes[m] = meshHash( scene->mMeshes[m] );
+    };
+    if ( pool )
+        pool->parallelFor( meshCount, hashMesh );
+    else
+        for ( size_t m = 0; m < meshCount; ++m )
+            hashMesh( m );
+
+    // Hash -> the first meshes seen with it (several only on a collision).
+    std::unordered_map<uint64_t, std::vector<unsigned int>> firsts;
+    for ( unsigned int m = 0; m < meshCount; ++m )
+    {
+        twins[m] = m;
+        if ( !canShare( scene->mMeshes[m] ) )
+            continue;
+        auto& candidates = firsts[hashes[m]];
+        for ( unsigned int c : candidates )
+            if ( sameGeometry( scene->mMeshes[c], scene->mMeshes[m] ) )
+            {
+                twins[m] = c;
+                break;
+            }
+        if ( twins[m] == m )
+            candidates.push_back( m );
+    }
+    return twins;
+}
+
+unsigned int twinCount( const std::vector<unsigned int>& twins )
+{
+    unsigned int count = 0;
+    for ( unsigned int m = 0; m < twins.size(); ++m )
+        count += twins[m] != m;
+    return count;
+}
+
+} // namespace lodgen
@@ -0,0 +1,25 @@
+#pragma once
+#include "thread_pool.hpp"
+#include <assimp/scene.h>
+#include <vector>
+
+namespace lodgen
+{
+
+// Identical geometry across the meshes of a scene.
+//
+// CAD exports and kitbashed scenes often repeat one mesh instead of
+// instancing it. Meshes with the same primitive types, vertex streams and
+// faces simplify to the same result, so each group needs simplifying only once
+// (see simplifyScene). Names and materials may differ. Meshes with bones or
+// morph targets are never grouped.
+
+// For every mesh of `scene`, the index of the first mesh identical to it
+// (its own index if there is none). Meshes are hashed on the pool, if any,
+// and equal hashes are confirmed byte by byte.
+std::vector<unsigned int> findMeshTwins( const aiScene* scene, ThreadPool* pool = nullptr );
+
+// Number of meshes `twins` maps to another mesh.
+unsigned int twinCount( const std::vector<unsigned int>& twins );
+
+} // namespace lodgen
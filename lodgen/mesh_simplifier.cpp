@@ -1,484 +1,767 @@
 ﻿#include "mesh_simplifier.hpp"
+#include "face_arena.hpp"
+#include "polyline_simplifier.hpp"
+#include "scratch_arena.hpp"
+#include "simplify_attributes.hpp"
+#include "stopwatch.hpp"
 #include <assimp/mesh.h>
 #include <meshoptimizer.h>
 #include <algorithm>
 #include <cassert>
-#include <cstring>
+#include <limits>
+#include <numeric>
 #include <vector>
 
 namespace lodgen
 {
 
-// ── Interleaved vertex layout ────────────────────────────────────────────────
-//
-// Used ONLY for the compaction step so that one remap pass handles all
-// attributes atomically.  NOT passed to meshopt_simplify* (would exceed
-// the 256-byte stride limit with max UV/color channels).
-
 static constexpr unsigned int kMaxUVChannels = AI_MAX_NUMBER_OF_TEXTURECOORDS;
 static constexpr unsigned int kMaxColorChannels = AI_MAX_NUMBER_OF_COLOR_SETS;
 
-struct InterleavedVertex
+// ── Bone weight remap ─────────────────────────────────────────────────────────
+//
+// After vertex compaction, mBones[b]->mWeights[j].mVertexId still holds old
+// vertex indices.  We must translate them through the remap table and drop any
+// weights whose vertex was removed (remap[old] == ~0u).
+
+static void remapBoneWeights( aiMesh* mesh, std::span<const unsigned int> remap )
 {
-    float px, py, pz;                // position
-    float nx, ny, nz;                // normal
-    float tx, ty, tz;                // tangent
-    float bx, by, bz;               // bitangent
-    float uv[kMaxUVChannels][3];     // texture coords
-    float col[kMaxColorChannels][4]; // vertex colours
-};
+    if ( !mesh->mBones )
+        return;
 
-// ── Mesh layout detection ────────────────────────────────────────────────────
+    for ( unsigned int b = 0; b < mesh->mNumBones; ++b )
+    {
+        aiBone* bone = mesh->mBones[b];
+        if ( !bone ) continue;
 
-struct MeshLayout
+        // Translate and compact in-place, dropping removed vertices.
+        unsigned int out = 0;
+        for ( unsigned int w = 0; w < bone->mNumWeights; ++w )
+        {
+            unsigned int oldIdx = bone->mWeights[w].mVertexId;
+            if ( oldIdx < remap.size() && remap[oldIdx] != ~0u )
+            {
+                bone->mWeights[out] = bone->mWeights[w];
+                bone->mWeights[out].mVertexId = remap[oldIdx];
+                ++out;
+            }
+        }
+        bone->mNumWeights = out;
+    }
+}
+
+// ── Compaction: remap every SoA stream with one remap table ──────────────────
+//
+// Each stream present on the mesh is copied once into a new array of the
+// compacted size; absent streams and channels cost nothing.
+
+template <typename T>
+static void remapStream( T*& stream, size_t vertexCount, size_t newCount, std::span<const unsigned int> remap )
 {
-    bool hasNormals = false;
-    bool hasTangents = false;
-    unsigned int uvChannels = 0;
-    unsigned int colorChannels = 0;
-};
+    if ( !stream )
+        return;
+    T* compacted = new T[newCount];
+    meshopt_remapVertexBuffer( compacted, stream, vertexCount, sizeof( T ), remap.data() );
+    delete[] stream;
+    stream = compacted;
+}
 
-static MeshLayout detectLayout( const aiMesh* mesh )
+static void compactVertices( aiMesh* mesh, std::span<const unsigned int> remap, size_t newCount )
 {
-    MeshLayout layout;
-    layout.hasNormals = ( mesh->mNormals != nullptr );
-    layout.hasTangents = ( mesh->mTangents != nullptr );
+    const size_t N = mesh->mNumVertices;
 
+    remapStream( mesh->mVertices, N, newCount, remap );
+    remapStream( mesh->mNormals, N, newCount, remap );
+    remapStream( mesh->mTangents, N, newCount, remap );
+    remapStream( mesh->mBitangents, N, newCount, remap );
     for ( unsigned int ch = 0; ch < kMaxUVChannels; ++ch )
-    {
-        if ( !mesh->mTextureCoords[ch] ) break;
-        ++layout.uvChannels;
-    }
+        remapStream( mesh->mTextureCoords[ch], N, newCount, remap );
     for ( unsigned int ch = 0; ch < kMaxColorChannels; ++ch )
-    {
-        if ( !mesh->mColors[ch] ) break;
-        ++layout.colorChannels;
-    }
-    return layout;
-}
+        remapStream( mesh->mColors[ch], N, newCount, remap );
 
-// ── Pack: assimp SoA → interleaved AoS ───────────────────────────────────────
+    remapBoneWeights( mesh, remap );
+    mesh->mNumVertices = static_cast<unsigned int>( newCount );
+}
 
-static std::vector<InterleavedVertex> packVertices(
-    const aiMesh* mesh, const MeshLayout& layout )
+// Old → new vertex index in order of first use by `indices` (~0u for unused
+// vertices); returns the number used. meshopt_optimizeVertexFetchRemap does
+// the same for triangle lists only.
+static size_t firstUseRemap( std::span<unsigned int> remap, std::span<const unsigned int> indices )
 {
-    unsigned int N = mesh->mNumVertices;
-    std::vector<InterleavedVertex> verts( N );
-    std::memset( verts.data(), 0, N * sizeof( InterleavedVertex ) );
+    std::fill( remap.begin(), remap.end(), ~0u );
+    unsigned int next = 0;
+    for ( unsigned int i : indices )
+        if ( remap[i] == ~0u )
+            remap[i] = next++;
+    return next;
+}
 
-    for ( unsigned int i = 0; i < N; ++i )
-    {
-        auto& v = verts[i];
+// ── Index extraction / face write-back ───────────────────────────────────────
 
-        v.px = mesh->mVertices[i].x;
-        v.py = mesh->mVertices[i].y;
-        v.pz = mesh->mVertices[i].z;
+static ScratchVector<unsigned int> extractIndices( const aiMesh* mesh )
+{
+    ScratchVector<unsigned int> indices( faceIndexCount( mesh ) );
+    copyFaceIndices( mesh, indices ); // bulk copy for meshes lodgen already wrote
+    return indices;
+}
 
-        if ( layout.hasNormals )
-        {
-            v.nx = mesh->mNormals[i].x;
-            v.ny = mesh->mNormals[i].y;
-            v.nz = mesh->mNormals[i].z;
-        }
-        if ( layout.hasTangents )
-        {
-            v.tx = mesh->mTangents[i].x;
-            v.ty = mesh->mTangents[i].y;
-            v.tz = mesh->mTangents[i].z;
-            v.bx = mesh->mBitangents[i].x;
-            v.by = mesh->mBitangents[i].y;
-            v.bz = mesh->mBitangents[i].z;
-        }
-        for ( unsigned int ch = 0; ch < layout.uvChannels; ++ch )
-        {
-            v.uv[ch][0] = mesh->mTextureCoords[ch][i].x;
-            v.uv[ch][1] = mesh->mTextureCoords[ch][i].y;
-            v.uv[ch][2] = mesh->mTextureCoords[ch][i].z;
-        }
-        for ( unsigned int ch = 0; ch < layout.colorChannels; ++ch )
-        {
-            v.col[ch][0] = mesh->mColors[ch][i].r;
-            v.col[ch][1] = mesh->mColors[ch][i].g;
-            v.col[ch][2] = mesh->mColors[ch][i].b;
-            v.col[ch][3] = mesh->mColors[ch][i].a;
-        }
-    }
-    return verts;
+static void writeBackFaces(
+    aiMesh* mesh, std::span<const unsigned int> indices, unsigned int faceSize, const SimplifyOptions& opts )
+{
+    if ( opts.contiguousFaces )
+        setFaces( mesh, indices, faceSize ); // one block instead of a new[] per face
+    else
+        setSeparateFaces( mesh, indices, faceSize );
 }
 
-// ── Unpack: interleaved AoS → assimp SoA (reallocates all arrays) ────────────
+// ── Engine selection ─────────────────────────────────────────────────────────
 
-static void unpackVertices(
-    aiMesh* mesh,
-    const std::vector<InterleavedVertex>& verts,
-    const MeshLayout& layout )
+const char* engineName( SimplifyEngine engine )
 {
-    unsigned int N = static_cast<unsigned int>( verts.size() );
-
-    delete[] mesh->mVertices;   mesh->mVertices = nullptr;
-    delete[] mesh->mNormals;    mesh->mNormals = nullptr;
-    delete[] mesh->mTangents;   mesh->mTangents = nullptr;
-    delete[] mesh->mBitangents; mesh->mBitangents = nullptr;
-    for ( unsigned int ch = 0; ch < kMaxUVChannels; ++ch )
+    switch ( engine )
     {
-        delete[] mesh->mTextureCoords[ch];
-        mesh->mTextureCoords[ch] = nullptr;
+    case SimplifyEngine::Quality: return "quality";
+    case SimplifyEngine::Sloppy:  return "sloppy";
+    case SimplifyEngine::Auto:    return "auto";
     }
-    for ( unsigned int ch = 0; ch < kMaxColorChannels; ++ch )
+    return "?";
+}
+
+const char* seamModeName( SeamMode mode )
+{
+    switch ( mode )
     {
-        delete[] mesh->mColors[ch];
-        mesh->mColors[ch] = nullptr;
+    case SeamMode::Keep:        return "keep";
+    case SeamMode::WeldNormals: return "normals";
+    case SeamMode::WeldAll:     return "all";
     }
+    return "?";
+}
 
-    mesh->mNumVertices = N;
+static SimplifyEngine resolveEngine( const SimplifyOptions& opts, const aiMesh* mesh )
+{
+    if ( opts.engine != SimplifyEngine::Auto )
+        return opts.engine;
+    return mesh->mNumFaces > opts.sloppyTriangles ? SimplifyEngine::Sloppy : SimplifyEngine::Quality;
+}
 
-    mesh->mVertices = new aiVector3D[N];
-    for ( unsigned int i = 0; i < N; ++i )
-    {
-        mesh->mVertices[i].x = verts[i].px;
-        mesh->mVertices[i].y = verts[i].py;
-        mesh->mVertices[i].z = verts[i].pz;
-    }
+// ── Chunked simplification of one huge index buffer ─────────────────────────
+//
+// The single-threaded simplifier dominates for meshes of millions of
+// triangles. Triangles are sorted spatially and cut into runs of about
+// opts.chunkTriangles; every run is simplified on its own (in parallel with a
+// pool) with SimplifySparse, so its cost follows its own size, and with every
+// vertex whose position is shared with another run locked, so runs cannot pull
+// apart. Runs only go to twice their share of the target: forcing a small run
+// all the way against its locked border distorts it. A final unlocked pass
+// over the joined result, at most twice the target, takes the seams and the
+// rest of the way.
+//
+// Relative errors would be measured against each run's own extent, so runs
+// and the final pass work in absolute units; the result is converted back.
+
+static size_t reduceChunked(
+    std::span<const unsigned int> indices,
+    const float* positions,
+    size_t vertexCount,
+    const SimplifyAttributes& attrs,
+    size_t targetIndexCount,
+    const SimplifyOptions& opts,
+    ThreadPool* pool,
+    unsigned int* simplified,
+    float& error )
+{
+    const float scale = opts.absoluteError ? 1.0f : meshopt_simplifyScale( positions, vertexCount, kPosStride );
+    const float limit = opts.maxError * scale;
+    const unsigned int options = meshopt_SimplifyErrorAbsolute | attrs.options;
 
-    if ( layout.hasNormals )
-    {
-        mesh->mNormals = new aiVector3D[N];
-        for ( unsigned int i = 0; i < N; ++i )
-        {
-            mesh->mNormals[i].x = verts[i].nx;
-            mesh->mNormals[i].y = verts[i].ny;
-            mesh->mNormals[i].z = verts[i].nz;
-        }
-    }
+    ScratchVector<unsigned int> sorted( indices.size() );
+    meshopt_spatialSortTriangles( sorted.data(), indices.data(), indices.size(), positions, vertexCount, kPosStride );
 
-    if ( layout.hasTangents )
-    {
-        mesh->mTangents = new aiVector3D[N];
-        mesh->mBitangents = new aiVector3D[N];
-        for ( unsigned int i = 0; i < N; ++i )
-        {
-            mesh->mTangents[i].x = verts[i].tx;
-            mesh->mTangents[i].y = verts[i].ty;
-            mesh->mTangents[i].z = verts[i].tz;
-            mesh->mBitangents[i].x = verts[i].bx;
-            mesh->mBitangents[i].y = verts[i].by;
-            mesh->mBitangents[i].z = verts[i].bz;
-        }
-    }
+    const size_t triangleCount = indices.size() / 3;
+    const size_t chunkCount    = ( triangleCount + opts.chunkTriangles - 1 ) / opts.chunkTriangles;
+    auto chunkBegin = [&]( size_t c ) { return c * triangleCount / chunkCount * 3; };
 
-    for ( unsigned int ch = 0; ch < layout.uvChannels; ++ch )
-    {
-        mesh->mTextureCoords[ch] = new aiVector3D[N];
-        for ( unsigned int i = 0; i < N; ++i )
+    // Lock every vertex at a position used by more than one chunk.
+    ScratchVector<unsigned int> positionOf( vertexCount );
+    meshopt_generatePositionRemap( positionOf.data(), positions, vertexCount, kPosStride );
+
+    ScratchVector<unsigned int>  owner( vertexCount, ~0u );
+    ScratchVector<unsigned char> lock( vertexCount, 0 );
+    for ( size_t c = 0; c < chunkCount; ++c )
+        for ( size_t i = chunkBegin( c ); i < chunkBegin( c + 1 ); ++i )
         {
-            mesh->mTextureCoords[ch][i].x = verts[i].uv[ch][0];
-            mesh->mTextureCoords[ch][i].y = verts[i].uv[ch][1];
-            mesh->mTextureCoords[ch][i].z = verts[i].uv[ch][2];
+            unsigned int& o = owner[positionOf[sorted[i]]];
+            if ( o == ~0u )
+                o = static_cast<unsigned int>( c );
+            else if ( o != c )
+                lock[positionOf[sorted[i]]] = meshopt_SimplifyVertex_Lock;
         }
-    }
+    for ( size_t v = 0; v < vertexCount; ++v )
+        lock[v] = lock[positionOf[v]] | ( attrs.vertexFlags.empty() ? 0 : attrs.vertexFlags[v] );
+
+    // Every chunk writes its result over its own range of `joined`.
+    ScratchVector<unsigned int> joined( indices.size() );
+    ScratchVector<size_t>       counts( chunkCount );
+    ScratchVector<float>        errors( chunkCount );
+
+    auto reduceChunk = [&]( size_t c ) {
+        ScratchArena::Scope scratch; // this thread's meshopt temporaries
+        const size_t begin  = chunkBegin( c );
+        const size_t count  = chunkBegin( c + 1 ) - begin;
+        const size_t target = std::max<size_t>( 2 * count * targetIndexCount / indices.size() / 3 * 3, 3 );
+        counts[c] = meshopt_simplifyWithAttributes(
+            joined.data() + begin, sorted.data() + begin, count,
+            positions, vertexCount, kPosStride,
+            attrs.data.data(), attrs.stride, attrs.weights.data(), attrs.count,
+            lock.data(), target, limit, options | meshopt_SimplifySparse, &errors[c] );
+    };
+    if ( pool )
+        pool->parallelFor( chunkCount, reduceChunk );
+    else
+        for ( size_t c = 0; c < chunkCount; ++c )
+            reduceChunk( c );
 
-    for ( unsigned int ch = 0; ch < layout.colorChannels; ++ch )
+    size_t joinedCount = 0;
+    for ( size_t c = 0; c < chunkCount; ++c )
     {
-        mesh->mColors[ch] = new aiColor4D[N];
-        for ( unsigned int i = 0; i < N; ++i )
-        {
-            mesh->mColors[ch][i].r = verts[i].col[ch][0];
-            mesh->mColors[ch][i].g = verts[i].col[ch][1];
-            mesh->mColors[ch][i].b = verts[i].col[ch][2];
-            mesh->mColors[ch][i].a = verts[i].col[ch][3];
-        }
+        std::copy_n( joined.data() + chunkBegin( c ), counts[c], joined.data() + joinedCount );
+        joinedCount += counts[c];
     }
+
+    float seamError = 0;
+    const size_t newIndexCount = meshopt_simplifyWithAttributes(
+        simplified, joined.data(), joinedCount,
+        positions, vertexCount, kPosStride,
+        attrs.data.data(), attrs.stride, attrs.weights.data(), attrs.count,
+        attrs.vertexFlags.empty() ? nullptr : attrs.vertexFlags.data(), targetIndexCount, limit, options, &seamError );
+
+    const float chunkError = *std::max_element( errors.begin(), errors.end() );
+    error = scale > 0 ? ( chunkError + seamError ) / scale : 0.0f;
+    return newIndexCount;
 }
 
-// ── Compact position array for meshopt calls ─────────────────────────────────
+// ── Simplify one index buffer (steps 3–4 of the pipeline) ───────────────────
 //
-// meshopt_simplify* asserts vertex_positions_stride <= 256.
-// sizeof(InterleavedVertex) is 272 bytes with max channels, so we extract
-// a separate tightly-packed float3 array for positions.  This array is used
-// ONLY by meshopt; compaction still operates on the full interleaved buffer.
-
-static std::vector<float> extractPositions(
-    const std::vector<InterleavedVertex>& verts )
+// reduceIndices runs the chosen engine towards `ratio` of `indices` and fills
+// the error, target and engine of `result`. simplifyIndices, shared by
+// simplify() and simplifyChain(), adds cache + overdraw optimisation and the
+// stage timings.
+// Both write to `simplified` (room for indices.size()) and return the new
+// count; indices still address the uncompacted vertex buffer.
+
+static size_t reduceIndices(
+    std::span<const unsigned int> indices,
+    const float* positions,
+    size_t vertexCount,
+    const SimplifyAttributes& attrs,
+    float ratio,
+    SimplifyEngine engine,
+    const SimplifyOptions& opts,
+    ThreadPool* pool,
+    unsigned int* simplified,
+    SimplifyResult& result )
 {
-    std::vector<float> pos( verts.size() * 3 );
-    for ( size_t i = 0; i < verts.size(); ++i )
+    size_t targetIndexCount = ( static_cast<size_t>( indices.size() * ratio ) / 3 ) * 3;
+    targetIndexCount = std::max( targetIndexCount, size_t( 3 ) );
+    result.targetTriangles = ratio > 0 ? static_cast<unsigned int>( targetIndexCount / 3 ) : 0;
+    result.engine          = engine;
+
+    size_t newIndexCount = 0;
+
+    const unsigned int options = opts.absoluteError ? meshopt_SimplifyErrorAbsolute : 0;
+
+    if ( engine == SimplifyEngine::Sloppy )
     {
-        pos[i * 3 + 0] = verts[i].px;
-        pos[i * 3 + 1] = verts[i].py;
-        pos[i * 3 + 2] = verts[i].pz;
+        // No error limit with a triangle target: clustering is cheap enough to
+        // always go all the way. The sloppy simplifier only works in relative
+        // units, so absolute errors are converted through the mesh scale.
+        const float scale = opts.absoluteError ? meshopt_simplifyScale( positions, vertexCount, kPosStride ) : 1.0f;
+        const float limit = ratio > 0 ? std::numeric_limits<float>::max()
+                                      : ( scale > 0 ? opts.maxError / scale : 0.0f );
+        newIndexCount = meshopt_simplifySloppy(
+            simplified,
+            indices.data(),
+            indices.size(),
+            positions,
+            vertexCount,
+            kPosStride,
+            nullptr,                        // no locked vertices
+            targetIndexCount,
+            limit,
+            &result.error );
+        result.error *= scale;
+
+        // Clustering can collapse a small mesh entirely at low targets; the
+        // quality simplifier keeps at least something.
+        if ( newIndexCount == 0 )
+            engine = result.engine = SimplifyEngine::Quality;
     }
-    return pos;
-}
 
-// ── Build attribute arrays for meshopt_simplifyWithAttributes ─────────────────
-//
-// Also subject to stride <= 256 and attribute_count <= kMaxAttributes (16).
-// With 8 UV channels * 2 + 3 normals = 19 — exceeds kMaxAttributes.
-// So we cap to the first few UV channels that matter most and normals.
+    if ( engine == SimplifyEngine::Quality && opts.chunkTriangles > 0 &&
+         indices.size() / 3 >= size_t( opts.chunkTriangles ) * 2 )
+    {
+        newIndexCount = reduceChunked( indices, positions, vertexCount, attrs, targetIndexCount, opts, pool,
+                                       simplified, result.error );
+    }
+    else if ( engine == SimplifyEngine::Quality && attrs.count > 0 )
+    {
+        newIndexCount = meshopt_simplifyWithAttributes(
+            simplified,
+            indices.data(),
+            indices.size(),
+            positions,                      // mVertices, float3
+            vertexCount,
+            kPosStride,                     // 12 bytes — well within 256 limit
+            attrs.data.data(),
+            attrs.stride,
+            attrs.weights.data(),
+            attrs.count,
+            attrs.vertexFlags.empty() ? nullptr : attrs.vertexFlags.data(), // seam protection, if any
+            targetIndexCount,
+            opts.maxError,
+            options | attrs.options,
+            &result.error );
+    }
+    else if ( engine == SimplifyEngine::Quality )
+    {
+        newIndexCount = meshopt_simplify(
+            simplified,
+            indices.data(),
+            indices.size(),
+            positions,
+            vertexCount,
+            kPosStride,
+            targetIndexCount,
+            opts.maxError,
+            options | attrs.options,
+            &result.error );
+    }
 
-static constexpr size_t kMeshoptMaxAttributes = 32; // meshoptimizer hard limit (attribute_count must be <= 32)
+    return newIndexCount;
+}
 
-struct SimplifyAttributes
+static size_t simplifyIndices(
+    std::span<const unsigned int> indices,
+    const float* positions,
+    size_t vertexCount,
+    const SimplifyAttributes& attrs,
+    float ratio,
+    SimplifyEngine engine,
+    const SimplifyOptions& opts,
+    ThreadPool* pool,
+    unsigned int* simplified,
+    SimplifyResult& result )
 {
-    std::vector<float> data;
-    std::vector<float> weights;
-    size_t             stride;     // bytes
-    size_t             count;      // components per vertex
-};
-
-static SimplifyAttributes buildSimplifyAttributes(
-    const std::vector<InterleavedVertex>& verts,
-    const MeshLayout& layout )
-{
-    SimplifyAttributes attrs{};
+    Stopwatch watch;
 
-    // Budget: 2 floats per UV channel + 3 for normals, capped at kMeshoptMaxAttributes
-    unsigned int uvChansToUse = layout.uvChannels;
-    size_t needed = uvChansToUse * 2 + ( layout.hasNormals ? 3 : 0 );
+    size_t newIndexCount = reduceIndices( indices, positions, vertexCount, attrs, ratio, engine, opts, pool,
+                                          simplified, result );
+    result.simplifySeconds = watch.lap();
 
-    // If we exceed the limit, reduce UV channels (normals cost 3 slots)
-    while ( needed > kMeshoptMaxAttributes && uvChansToUse > 0 )
-    {
-        --uvChansToUse;
-        needed = uvChansToUse * 2 + ( layout.hasNormals ? 3 : 0 );
-    }
-    // If still over (unlikely: 0 UVs + 3 normals = 3), drop normals
-    bool useNormals = layout.hasNormals && ( needed <= kMeshoptMaxAttributes );
+    meshopt_optimizeVertexCache(
+        simplified, simplified,
+        newIndexCount, vertexCount );
 
-    size_t count = uvChansToUse * 2 + ( useNormals ? 3 : 0 );
+    meshopt_optimizeOverdraw(
+        simplified, simplified, newIndexCount,
+        positions,
+        vertexCount,
+        kPosStride,
+        1.05f );
+    result.optimizeSeconds = watch.lap();
+
+    return newIndexCount;
+}
 
-    attrs.count = count;
-    attrs.stride = count * sizeof( float );
+// ── Point clouds ─────────────────────────────────────────────────────────────
+//
+// meshopt_simplifyPoints picks the points to keep, weighing colour set 0
+// against position; the survivors are then sorted spatially so that nearby
+// points are nearby in the buffer. One remap table does both for every stream.
 
-    if ( count == 0 )
-        return attrs;
+static void simplifyPointCloud( aiMesh* mesh, float ratio, const SimplifyOptions& opts, SimplifyResult& result )
+{
+    Stopwatch watch;
 
-    // Also check stride <= 256
-    if ( attrs.stride > 256 )
+    // Points no face references are dropped first, so the simplifier only
+    // chooses among points that are drawn. Clouds without faces (as PLY
+    // imports them) are all points and stay without faces.
+    const bool hasFaces = mesh->mNumFaces > 0;
+    if ( hasFaces )
     {
-        // Shouldn't happen with 16 attrs * 4 bytes = 64 bytes, but guard anyway
-        attrs = {};
-        return attrs;
+        auto indices = extractIndices( mesh );
+        ScratchVector<unsigned int> used( mesh->mNumVertices );
+        size_t usedCount = firstUseRemap( used, indices );
+        if ( usedCount < mesh->mNumVertices )
+            compactVertices( mesh, used, usedCount );
     }
+    const size_t pointCount = mesh->mNumVertices;
 
-    size_t N = verts.size();
-    attrs.data.resize( N * count );
-    attrs.weights.resize( count );
+    const size_t target = std::max<size_t>( 1, static_cast<size_t>( static_cast<double>( pointCount ) * ratio ) );
+    result.targetTriangles = static_cast<unsigned int>( target );
 
-    size_t offset = 0;
+    ScratchVector<unsigned int> kept( target );
+    const float* colors = mesh->mColors[0] ? reinterpret_cast<const float*>( mesh->mColors[0] ) : nullptr;
+    size_t keptCount = meshopt_simplifyPoints(
+        kept.data(), positionsOf( mesh ), pointCount, kPosStride,
+        colors, sizeof( aiColor4D ), opts.pointColorWeight, target );
+    kept.resize( keptCount );
+    result.simplifySeconds = watch.lap();
 
-    for ( unsigned int ch = 0; ch < uvChansToUse; ++ch )
+    ScratchVector<float> keptPositions( keptCount * 3 );
+    for ( size_t i = 0; i < keptCount; ++i )
     {
-        for ( size_t i = 0; i < N; ++i )
-        {
-            attrs.data[i * count + offset + 0] = verts[i].uv[ch][0];
-            attrs.data[i * count + offset + 1] = verts[i].uv[ch][1];
-        }
-        // First UV channel gets highest weight (usually the one that matters)
-        attrs.weights[offset + 0] = ( ch == 0 ) ? 1.5f : 0.8f;
-        attrs.weights[offset + 1] = ( ch == 0 ) ? 1.5f : 0.8f;
-        offset += 2;
+        const aiVector3D& p = mesh->mVertices[kept[i]];
+        keptPositions[i * 3 + 0] = p.x;
+        keptPositions[i * 3 + 1] = p.y;
+        keptPositions[i * 3 + 2] = p.z;
     }
+    ScratchVector<unsigned int> order( keptCount );
+    meshopt_spatialSortRemap( order.data(), keptPositions.data(), keptCount, kPosStride );
+    result.optimizeSeconds = watch.lap();
 
-    if ( useNormals )
+    ScratchVector<unsigned int> remap( pointCount, ~0u );
+    for ( size_t i = 0; i < keptCount; ++i )
+        remap[kept[i]] = order[i];
+    compactVertices( mesh, remap, keptCount );
+
+    if ( hasFaces )
     {
-        for ( size_t i = 0; i < N; ++i )
-        {
-            attrs.data[i * count + offset + 0] = verts[i].nx;
-            attrs.data[i * count + offset + 1] = verts[i].ny;
-            attrs.data[i * count + offset + 2] = verts[i].nz;
-        }
-        attrs.weights[offset + 0] = 0.5f;
-        attrs.weights[offset + 1] = 0.5f;
-        attrs.weights[offset + 2] = 0.5f;
+        ScratchVector<unsigned int> points( keptCount );
+        std::iota( points.begin(), points.end(), 0u );
+        writeBackFaces( mesh, points, 1, opts );
     }
-
-    return attrs;
+    result.compactSeconds = watch.lap();
 }
 
-// ── Bone weight remap ─────────────────────────────────────────────────────────
+// ── Line meshes ──────────────────────────────────────────────────────────────
 //
-// After vertex compaction, mBones[b]->mWeights[j].mVertexId still holds old
-// vertex indices.  We must translate them through the remap table and drop any
-// weights whose vertex was removed (remap[old] == ~0u).
+// Polylines rebuilt from the segments lose the vertices Douglas–Peucker ranks
+// lowest (see polyline_simplifier.hpp); the error limit and the reported error
+// follow SimplifyOptions::absoluteError like the triangle engines.
 
-static void remapBoneWeights( aiMesh* mesh, const std::vector<unsigned int>& remap )
+static void simplifyLineMesh( aiMesh* mesh, float ratio, const SimplifyOptions& opts, SimplifyResult& result )
 {
-    if ( !mesh->mBones )
-        return;
+    Stopwatch watch;
 
-    for ( unsigned int b = 0; b < mesh->mNumBones; ++b )
-    {
-        aiBone* bone = mesh->mBones[b];
-        if ( !bone ) continue;
-
-        // Translate and compact in-place, dropping removed vertices.
-        unsigned int out = 0;
-        for ( unsigned int w = 0; w < bone->mNumWeights; ++w )
-        {
-            unsigned int oldIdx = bone->mWeights[w].mVertexId;
-            if ( oldIdx < remap.size() && remap[oldIdx] != ~0u )
-            {
-                bone->mWeights[out] = bone->mWeights[w];
-                bone->mWeights[out].mVertexId = remap[oldIdx];
-                ++out;
-            }
-        }
-        bone->mNumWeights = out;
-    }
+    auto indices = extractIndices( mesh );
+    const size_t vertexCount = mesh->mNumVertices;
+    const float  scale = opts.absoluteError ? 1.0f : meshopt_simplifyScale( positionsOf( mesh ), vertexCount, kPosStride );
+
+    const size_t target = ratio > 0
+        ? std::max<size_t>( 1, static_cast<size_t>( static_cast<double>( mesh->mNumFaces ) * ratio ) ) : 0;
+    result.targetTriangles = static_cast<unsigned int>( target );
+
+    ScratchVector<unsigned int> simplified( indices.size() );
+    float error = 0;
+    simplified.resize( simplifyPolylines(
+        simplified.data(), indices, positionsOf( mesh ), vertexCount, target, opts.maxError * scale, &error ) );
+    result.error = scale > 0 ? error / scale : 0.0f;
+    result.simplifySeconds = watch.lap();
+
+    // Vertices in the order the polylines visit them.
+    ScratchVector<unsigned int> remap( vertexCount );
+    size_t newVertCount = firstUseRemap( remap, simplified );
+    for ( unsigned int& i : simplified )
+        i = remap[i];
+    compactVertices( mesh, remap, newVertCount );
+    writeBackFaces( mesh, simplified, 2, opts );
+    result.compactSeconds = watch.lap();
 }
 
-// ── Index extraction / face write-back ───────────────────────────────────────
+// ── Main entry point ─────────────────────────────────────────────────────────
 
-static std::vector<unsigned int> extractIndices( const aiMesh* mesh )
+bool canSimplify( const aiMesh* mesh )
 {
-    std::vector<unsigned int> indices;
-    indices.reserve( mesh->mNumFaces * 3 );
-    for ( unsigned int f = 0; f < mesh->mNumFaces; ++f )
-    {
-        const aiFace& face = mesh->mFaces[f];
-        for ( unsigned int j = 0; j < face.mNumIndices; ++j )
-            indices.push_back( face.mIndices[j] );
-    }
-    return indices;
+    // Only pure triangle meshes are simplified.
+    return mesh->mPrimitiveTypes == aiPrimitiveType_TRIANGLE && mesh->mNumFaces > 0;
 }
 
-static void writeBackFaces( aiMesh* mesh, const std::vector<unsigned int>& indices )
+bool canSimplifyPoints( const aiMesh* mesh )
 {
-    unsigned int faceCount = static_cast<unsigned int>( indices.size() / 3 );
-    delete[] mesh->mFaces;
-    mesh->mNumFaces = faceCount;
-    mesh->mFaces = new aiFace[faceCount];
-    for ( unsigned int f = 0; f < faceCount; ++f )
-    {
-        mesh->mFaces[f].mNumIndices = 3;
-        mesh->mFaces[f].mIndices = new unsigned int[3] {
-            indices[f * 3 + 0],
-                indices[f * 3 + 1],
-                indices[f * 3 + 2]
-        };
-    }
+    return mesh->mPrimitiveTypes == aiPrimitiveType_POINT && mesh->mNumVertices > 0;
 }
 
-// ── Main entry point ─────────────────────────────────────────────────────────
+bool canSimplifyLines( const aiMesh* mesh )
+{
+    return mesh->mPrimitiveTypes == aiPrimitiveType_LINE && mesh->mNumFaces > 0;
+}
 
-SimplifyResult simplify( aiMesh* mesh, float ratio )
+unsigned int primitiveCount( const aiMesh* mesh )
+{
+    return mesh->mNumFaces == 0 && canSimplifyPoints( mesh ) ? mesh->mNumVertices : mesh->mNumFaces;
+}
+
+SimplifyResult simplify( aiMesh* mesh, float ratio, const SimplifyOptions& opts, ThreadPool* pool )
 {
     SimplifyResult result{};
-    result.originalTriangles = mesh->mNumFaces;
+    result.originalTriangles   = primitiveCount( mesh );
+    result.simplifiedTriangles = result.originalTriangles; // unchanged unless simplified below
+    result.originalVertices    = mesh->mNumVertices;
+    result.simplifiedVertices  = mesh->mNumVertices;
+    result.targetTriangles     = result.originalTriangles;
+    result.engine              = SimplifyEngine::Quality;
+
+    // Every temporary below comes from this thread's scratch arena.
+    installMeshoptAllocator();
+    ScratchArena::Scope scratch;
+
+    // Point clouds have no error metric: only a ratio below 1 decimates them.
+    if ( canSimplifyPoints( mesh ) )
+    {
+        if ( ratio > 0.0f && ratio < 1.0f )
+            simplifyPointCloud( mesh, ratio, opts, result );
+        result.simplifiedTriangles = primitiveCount( mesh );
+        result.simplifiedVertices  = mesh->mNumVertices;
+        return result;
+    }
 
-    // Only simplify pure triangle meshes.
+    if ( canSimplifyLines( mesh ) )
+    {
+        if ( ratio < 1.0f )
+        {
+            simplifyLineMesh( mesh, ratio, opts, result );
+            result.accumulatedError = result.error;
+        }
+        result.simplifiedTriangles = mesh->mNumFaces;
+        result.simplifiedVertices  = mesh->mNumVertices;
+        return result;
+    }
+
+    // Otherwise only pure triangle meshes are simplified.
     // aiProcess_SortByPType can produce separate point/line meshes in the same
     // scene; passing those to meshopt would violate the index_count % 3 == 0
     // assert inside meshopt_optimizeVertexFetchRemap.
-    if ( mesh->mPrimitiveTypes != aiPrimitiveType_TRIANGLE )
+    if ( !canSimplify( mesh ) )
         return result;
 
     auto indices = extractIndices( mesh );
     if ( indices.empty() )
         return result;
 
-    // ── 1. Pack all vertex data into interleaved buffer ───────────────────────
-
-    MeshLayout layout = detectLayout( mesh );
-    auto verts = packVertices( mesh, layout );
+    const size_t vertexCount = mesh->mNumVertices;
 
-    // ── 2. Extract compact position array for meshopt (stride = 12 bytes) ────
+    // ── 1–2. Simplify (attribute-aware) + cache / overdraw optimisation ──────
     //
-    // meshopt asserts stride <= 256; InterleavedVertex is 272 bytes.
-    // Positions are extracted separately; the interleaved buffer is used
-    // only for the compaction remap.
+    // Positions are read straight from mVertices; only the attribute stream
+    // the quality simplifier weighs (UVs, normals) is gathered.
 
-    auto positions = extractPositions( verts );
-    constexpr size_t kPosStride = 3 * sizeof( float ); // 12 bytes
+    const SimplifyEngine engine = resolveEngine( opts, mesh );
+    SimplifyAttributes attrs{};
+    if ( engine == SimplifyEngine::Quality )
+        attrs = buildSimplifyAttributes( mesh, opts.seams );
+    ScratchVector<unsigned int> simplified( indices.size() );
+    simplified.resize( simplifyIndices(
+        indices, positionsOf( mesh ), vertexCount, attrs, ratio, engine, opts, pool, simplified.data(), result ) );
 
-    // ── 3. Simplify (attribute-aware) ─────────────────────────────────────────
+    // ── 3. Compact: one remap table applied to every vertex stream ───────────
 
-    size_t targetIndexCount = ( static_cast<size_t>( indices.size() * ratio ) / 3 ) * 3;
-    targetIndexCount = std::max( targetIndexCount, size_t( 3 ) );
+    Stopwatch compactWatch;
+    ScratchVector<unsigned int> remap( vertexCount );
+    size_t newVertCount = meshopt_optimizeVertexFetchRemap(
+        remap.data(),
+        simplified.data(),
+        simplified.size(),
+        vertexCount );
+
+    meshopt_remapIndexBuffer(
+        simplified.data(), simplified.data(),
+        simplified.size(), remap.data() );
+
+    // ── 4. Remap streams and bone weights, write faces ───────────────────────
+
+    compactVertices( mesh, remap, newVertCount );
+    writeBackFaces( mesh, simplified, 3, opts );
+    result.compactSeconds = compactWatch.elapsed();
+
+    result.simplifiedTriangles = mesh->mNumFaces;
+    result.simplifiedVertices  = mesh->mNumVertices;
+    result.accumulatedError    = result.error;
+    return result;
+}
 
-    auto attrs = buildSimplifyAttributes( verts, layout );
+// ── Multi-target entry point ─────────────────────────────────────────────────
 
-    std::vector<unsigned int> simplified( indices.size() );
-    size_t newIndexCount;
+SimplifyChainResult simplifyChain(
+    aiMesh* mesh, std::span<const float> ratios, const SimplifyOptions& opts, ThreadPool* pool )
+{
+    SimplifyChainResult chain;
+    chain.indexBuffers.resize( ratios.size() );
+    chain.results.resize( ratios.size() );
 
-    if ( attrs.count > 0 )
+    for ( auto& r : chain.results )
     {
-        newIndexCount = meshopt_simplifyWithAttributes(
-            simplified.data(),
-            indices.data(),
-            indices.size(),
-            positions.data(),               // compact float3 array
-            verts.size(),
-            kPosStride,                     // 12 bytes — well within 256 limit
-            attrs.data.data(),
-            attrs.stride,
-            attrs.weights.data(),
-            attrs.count,
-            nullptr,                        // no locked vertices
-            targetIndexCount,
-            0.01f,
-            0,
-            &result.error );
+        r.originalTriangles   = mesh->mNumFaces;
+        r.simplifiedTriangles = mesh->mNumFaces;
+        r.originalVertices    = mesh->mNumVertices;
+        r.simplifiedVertices  = mesh->mNumVertices;
+        r.targetTriangles     = mesh->mNumFaces;
+        r.engine              = SimplifyEngine::Quality;
     }
-    else
+
+    installMeshoptAllocator();
+    ScratchArena::Scope scratch;
+
+    // Same restriction as simplify(): other primitive types pass through.
+    auto indices = extractIndices( mesh );
+    if ( !canSimplify( mesh ) || indices.empty() || ratios.empty() )
     {
-        newIndexCount = meshopt_simplify(
-            simplified.data(),
-            indices.data(),
-            indices.size(),
-            positions.data(),
-            verts.size(),
-            kPosStride,
-            targetIndexCount,
-            0.01f,
-            0,
-            &result.error );
+        for ( auto& buffer : chain.indexBuffers )
+            buffer.assign( indices.begin(), indices.end() );
+        return chain;
     }
 
-    simplified.resize( newIndexCount );
+    // ── 1. Build attributes ONCE ─────────────────────────────────────────────
 
-    // ── 4. Post-simplification cache + overdraw optimisation ──────────────────
+    const size_t vertexCount = mesh->mNumVertices;
+    const SimplifyEngine engine = resolveEngine( opts, mesh );
+    SimplifyAttributes attrs{};
+    if ( engine == SimplifyEngine::Quality )
+        attrs = buildSimplifyAttributes( mesh, opts.seams );
 
-    meshopt_optimizeVertexCache(
-        simplified.data(), simplified.data(),
-        simplified.size(), verts.size() );
+    // ── 2. One simplified index buffer per ratio ─────────────────────────────
 
-    meshopt_optimizeOverdraw(
-        simplified.data(), simplified.data(), simplified.size(),
-        positions.data(),
-        verts.size(),
-        kPosStride,
-        1.05f );
+    // Each level is simplified into one reused scratch buffer and copied out at
+    // its final size.
+    ScratchVector<unsigned int> simplified( indices.size() );
+    size_t totalIndexCount = 0;
+    for ( size_t i = 0; i < ratios.size(); ++i )
+    {
+        size_t count = simplifyIndices(
+            indices, positionsOf( mesh ), vertexCount, attrs, ratios[i], engine, opts, pool, simplified.data(),
+            chain.results[i] );
+        chain.indexBuffers[i].assign( simplified.begin(), simplified.begin() + count );
+        chain.results[i].simplifiedTriangles = static_cast<unsigned int>( chain.indexBuffers[i].size() / 3 );
+        chain.results[i].accumulatedError    = chain.results[i].error;
+        totalIndexCount += chain.indexBuffers[i].size();
+    }
 
-    // ── 5. Compact: remap the single interleaved buffer ──────────────────────
+    // ── 3. Compact against the union of all levels ───────────────────────────
     //
-    // One remap pass handles ALL vertex attributes atomically.
+    // Fetch order follows the levels in the order given, so the vertices of
+    // the first level are packed together at the start of the buffer.
+
+    Stopwatch compactWatch;
+    ScratchVector<unsigned int> all;
+    all.reserve( totalIndexCount );
+    for ( const auto& buffer : chain.indexBuffers )
+        all.insert( all.end(), buffer.begin(), buffer.end() );
 
-    std::vector<unsigned int> remap( verts.size() );
+    ScratchVector<unsigned int> remap( vertexCount );
     size_t newVertCount = meshopt_optimizeVertexFetchRemap(
-        remap.data(),
-        simplified.data(),
-        simplified.size(),
-        verts.size() );
+        remap.data(), all.data(), all.size(), vertexCount );
 
-    meshopt_remapIndexBuffer(
-        simplified.data(), simplified.data(),
-        simplified.size(), remap.data() );
+    for ( auto& buffer : chain.indexBuffers )
+        meshopt_remapIndexBuffer( buffer.data(), buffer.data(), buffer.size(), remap.data() );
 
-    std::vector<InterleavedVertex> compacted( newVertCount );
-    for ( size_t i = 0; i < verts.size(); ++i )
-        if ( remap[i] != ~0u )
-            compacted[remap[i]] = verts[i];
+    // ── 4. Install the shared vertex buffer; faces take the first level ──────
 
-    // ── 6. Remap bone weights, unpack back into assimp SoA + write faces ──────
+    compactVertices( mesh, remap, newVertCount );
+    writeBackFaces( mesh, chain.indexBuffers.front(), 3, opts );
 
-    remapBoneWeights( mesh, remap );
-    unpackVertices( mesh, compacted, layout );
-    writeBackFaces( mesh, simplified );
+    chain.results.front().compactSeconds = compactWatch.elapsed();
+    for ( auto& r : chain.results )
+        r.simplifiedVertices = mesh->mNumVertices;
 
-    result.simplifiedTriangles = mesh->mNumFaces;
-    return result;
+    return chain;
+}
+
+// ── Error curve ──────────────────────────────────────────────────────────────
+
+std::vector<ErrorCurvePoint> errorCurve(
+    const aiMesh* mesh, std::span<const float> ratios, const SimplifyOptions& opts )
+{
+    std::vector<ErrorCurvePoint> curve;
+    if ( !canSimplify( mesh ) || ratios.empty() )
+        return curve;
+
+    installMeshoptAllocator();
+    ScratchArena::Scope scratch;
+
+    auto current = extractIndices( mesh );
+    const size_t originalCount = current.size();
+    const size_t vertexCount   = mesh->mNumVertices;
+
+    const SimplifyEngine engine = resolveEngine( opts, mesh );
+    SimplifyAttributes attrs{};
+    if ( engine == SimplifyEngine::Quality )
+        attrs = buildSimplifyAttributes( mesh, opts.seams );
+
+    // Every step must reach its target, so the limit is lifted.
+    SimplifyOptions stepOpts = opts;
+    stepOpts.maxError = std::numeric_limits<float>::max();
+
+    ScratchVector<unsigned int> next( current.size() );
+    float error = 0;
+    for ( float ratio : ratios )
+    {
+        const float target = static_cast<float>( originalCount ) * ratio;
+        if ( current.size() > 3 && target < static_cast<float>( current.size() ) )
+        {
+            SimplifyResult step{};
+            size_t count = reduceIndices( current, positionsOf( mesh ), vertexCount, attrs,
+                                          target / static_cast<float>( current.size() ), engine, stepOpts,
+                                          nullptr, next.data(), step );
+            if ( count > 0 )
+            {
+                current.assign( next.begin(), next.begin() + count );
+                error += step.error;
+            }
+        }
+        curve.push_back( { static_cast<unsigned int>( current.size() / 3 ), error } );
+    }
+    return curve;
+}
+
+std::vector<SimplifyResult> simplifyScene(
+    aiScene* scene, float ratio, ThreadPool* pool, const SimplifyOptions& opts )
+{
+    return simplifyScene( scene, std::vector<float>( scene->mNumMeshes, ratio ), pool, opts );
+}
+
+std::vector<SimplifyResult> simplifyScene(
+    aiScene* scene, const std::vector<float>& meshRatios, ThreadPool* pool, const SimplifyOptions& opts,
+    std::span<const unsigned int> twins )
+{
+    assert( meshRatios.size() == scene->mNumMeshes );
+    assert( twins.empty() || twins.size() == scene->mNumMeshes );
+    std::vector<SimplifyResult> results( scene->mNumMeshes );
+
+    // Only the first mesh of each group of twins is simplified.
+    std::vector<unsigned int> order;
+    order.reserve( scene->mNumMeshes );
+    for ( unsigned int m = 0; m < scene->mNumMeshes; ++m )
+        if ( twins.empty() || twins[m] == m )
+            order.push_back( m );
+
+    if ( !pool || pool->size() == 1 )
+    {
+        for ( unsigned int m : order )
+            results[m] = simplify( scene->mMeshes[m], meshRatios[m], opts, pool );
+    }
+    else
+    {
+        // Largest meshes first so a single huge mesh does not start last and
+        // become the long tail.
+        std::stable_sort( order.begin(), order.end(), [&]( unsigned int a, unsigned int b ) {
+            return scene->mMeshes[a]->mNumFaces > scene->mMeshes[b]->mNumFaces;
+        } );
+
+        pool->parallelFor( order.size(), [&]( size_t i ) {
+            unsigned int m = order[i];
+            results[m] = simplify( scene->mMeshes[m], meshRatios[m], opts, pool );
+        } );
+    }
+
+    // Twins took no time of their own.
+    for ( unsigned int m = 0; m < twins.size(); ++m )
+        if ( twins[m] != m )
+        {
+            results[m] = results[twins[m]];
+            results[m].simplifySeconds = results[m].optimizeSeconds = results[m].compactSeconds = 0;
+        }
+    return results;
 }
 
 } // namespace lodgen
\ No newline at end of file
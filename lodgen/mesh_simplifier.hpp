@@ -1,16 +1,149 @@
 #pragma once
+#include "thread_pool.hpp"
 #include <assimp/mesh.h>
+#include <assimp/scene.h>
+#include <span>
+#include <vector>
 
 namespace lodgen
 {
 
+enum class SimplifyEngine
+{
+    Quality, // topology-preserving, attribute-aware; stops at the error limit
+    Sloppy,  // vertex clustering; ignores topology and attributes, always reaches the target
+    Auto,    // Sloppy for meshes above SimplifyOptions::sloppyTriangles, else Quality
+};
+
+// "quality", "sloppy" or "auto".
+const char* engineName( SimplifyEngine engine );
+
+// Vertices that share a position but not their attributes (UV / normal seams).
+enum class SeamMode
+{
+    Keep,        // collapse only along seams: islands and hard edges keep their vertices
+    WeldNormals, // normal and colour seams may collapse; UV seams are protected
+    WeldAll,     // any seam may collapse; the attribute error still weighs it
+};
+
+// "keep", "normals" or "all".
+const char* seamModeName( SeamMode mode );
+
+struct SimplifyOptions
+{
+    SimplifyEngine engine          = SimplifyEngine::Quality;
+    unsigned int   sloppyTriangles = 1000000; // Auto threshold, triangles of the mesh being simplified
+
+    // Simplification stops at this error even above the triangle target.
+    // Sloppy only honours it for error-driven calls (ratio 0).
+    float maxError      = 0.01f;
+    bool  absoluteError = false; // maxError and reported errors in model units, not relative to the mesh extent
+
+    // Quality meshes of at least twice this many triangles are split into
+    // spatial chunks of about this size, simplified concurrently with their
+    // shared borders locked, then joined by one final pass. 0 disables.
+    unsigned int chunkTriangles = 250000;
+
+    // Quality engine only; the sloppy simplifier ignores attributes anyway.
+    SeamMode seams = SeamMode::Keep;
+
+    // Point clouds: priority of colour set 0 over position when choosing the
+    // points to keep (meshopt_simplifyPoints; 1 is a balanced default).
+    float pointColorWeight = 1.0f;
+
+    // Write the new faces into one block (face_arena.hpp) instead of a new[]
+    // per face. Only for meshes freed through ScenePtr / MutableScenePtr or
+    // CowScene: ~aiMesh alone would corrupt the heap.
+    bool contiguousFaces = false;
+};
+
+// For point clouds the triangle counts below count points, for line meshes segments.
 struct SimplifyResult
 {
     unsigned int originalTriangles;
     unsigned int simplifiedTriangles;
-    float error;
+    float error;            // error introduced by this simplification step (units as SimplifyOptions::absoluteError)
+    float accumulatedError; // error vs. the source; sums the steps of a cascaded chain
+    unsigned int originalVertices;
+    unsigned int simplifiedVertices;
+    double simplifySeconds; // meshopt simplification
+    double optimizeSeconds; // vertex cache + overdraw optimisation
+    double compactSeconds;  // vertex fetch remap and write-back into the mesh
+    unsigned int targetTriangles; // requested; compare with simplifiedTriangles (0: error-driven)
+    SimplifyEngine engine;        // engine that ran (never Auto)
 };
 
-SimplifyResult simplify( aiMesh* mesh, float ratio );
+// True for the triangle meshes simplify() simplifies. With canSimplifyPoints
+// and canSimplifyLines, everything simplify() modifies; other meshes pass
+// through untouched.
+bool canSimplify( const aiMesh* mesh );
+
+// True if `mesh` is a point cloud simplify() decimates (pure aiPrimitiveType_POINT,
+// with point faces or, as PLY imports them, none).
+bool canSimplifyPoints( const aiMesh* mesh );
+
+// True if `mesh` is a line mesh simplify() decimates (pure aiPrimitiveType_LINE).
+bool canSimplifyLines( const aiMesh* mesh );
+
+// What SimplifyResult counts as triangles: the faces, or the points of a
+// point cloud without faces.
+unsigned int primitiveCount( const aiMesh* mesh );
+
+// Ratio 0 sets no triangle target: the mesh loses as many triangles as
+// opts.maxError allows (error-driven LODs).
+// Point clouds keep ratio * points (meshopt_simplifyPoints), spatially sorted;
+// having no error metric, they are left as they are at ratio 0. Line meshes
+// keep ratio * segments by Douglas–Peucker, within opts.maxError.
+// With a pool, the chunks of a huge mesh (see chunkTriangles) run on it.
+// The rewritten faces are allocated per face as assimp does, unless
+// opts.contiguousFaces.
+SimplifyResult simplify( aiMesh* mesh, float ratio, const SimplifyOptions& opts = {}, ThreadPool* pool = nullptr );
+
+struct SimplifyChainResult
+{
+    std::vector<std::vector<unsigned int>> indexBuffers; // one per ratio, into the shared vertices
+    std::vector<SimplifyResult>            results;      // one per ratio
+};
+
+// Simplify `mesh` to every ratio in one call. Simplifier attributes are built
+// once; each ratio then produces its own index buffer from the original indices.
+//
+// On return the mesh's vertex streams hold a single compacted buffer shared by
+// all levels (only vertices referenced by some level survive, in fetch order of
+// the levels as given), and its faces hold the first level. Non-triangle meshes
+// are left untouched and every buffer holds their original indices.
+// simplifiedVertices is the size of the shared buffer for every level, and the
+// shared compaction time is reported on the first level only.
+SimplifyChainResult simplifyChain(
+    aiMesh* mesh, std::span<const float> ratios, const SimplifyOptions& opts = {}, ThreadPool* pool = nullptr );
+
+struct ErrorCurvePoint
+{
+    unsigned int triangles;
+    float        error; // accumulated, in the units of SimplifyOptions::absoluteError
+};
+
+// Triangles left and error reached when simplifying `mesh` towards each of
+// `ratios` (descending), without modifying it. Each level is simplified from
+// the previous one without an error limit, so this is a fast, slightly
+// pessimistic estimate of what simplify() reaches from the source. Empty for
+// meshes canSimplify rejects.
+std::vector<ErrorCurvePoint> errorCurve(
+    const aiMesh* mesh, std::span<const float> ratios, const SimplifyOptions& opts = {} );
+
+// Simplify every mesh of `scene` in place; results are indexed like mMeshes.
+// With a pool, meshes are scheduled largest-first across its threads, and
+// chunks of huge meshes too. Each mesh is independent and chunking does not
+// depend on the pool, so the output matches the serial loop exactly.
+std::vector<SimplifyResult> simplifyScene(
+    aiScene* scene, float ratio, ThreadPool* pool = nullptr, const SimplifyOptions& opts = {} );
+
+// As above with a separate ratio per mesh (meshRatios.size() == mNumMeshes).
+// With `twins` (see findMeshTwins), a mesh m whose twins[m] != m is left
+// alone and reported with the result of twins[m] (without its timings), whose
+// data the caller then shares; twins must have equal ratios.
+std::vector<SimplifyResult> simplifyScene(
+    aiScene* scene, const std::vector<float>& meshRatios, ThreadPool* pool = nullptr,
+    const SimplifyOptions& opts = {}, std::span<const unsigned int> twins = {} );
 
 } // namespace lodgen
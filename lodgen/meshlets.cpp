@@ -0,0 +1,146 @@
+#include "meshlets.hpp"
+#include "face_arena.hpp"
+#include "mesh_simplifier.hpp"
+#include "scratch_arena.hpp"
+#include "simplify_attributes.hpp"
+#include <meshoptimizer.h>
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+namespace lodgen
+{
+
+struct MeshMeshlets
+{
+    std::vector<MeshletRecord> meshlets;
+    std::vector<uint32_t>      vertices;
+    std::vector<uint8_t>       triangles; // 3 per triangle
+};
+
+static MeshMeshlets buildMeshlets( const aiMesh* mesh, const MeshletOptions& opts )
+{
+    ScratchArena::Scope scratch;
+    const float* positions   = positionsOf( mesh );
+    const size_t vertexCount = mesh->mNumVertices;
+
+    ScratchVector<unsigned int> indices( faceIndexCount( mesh ) );
+    copyFaceIndices( mesh, indices );
+
+    const size_t minTriangles = opts.spatial ? std::max( opts.maxTriangles / 4, 1u ) : opts.maxTriangles;
+    ScratchVector<meshopt_Meshlet> meshlets(
+        meshopt_buildMeshletsBound( indices.size(), opts.maxVertices, minTriangles ) );
+    ScratchVector<unsigned int>  meshletVertices( indices.size() );
+    ScratchVector<unsigned char> meshletTriangles( indices.size() );
+    if ( opts.spatial )
+        meshlets.resize( meshopt_buildMeshletsSpatial(
+            meshlets.data(), meshletVertices.data(), meshletTriangles.data(), indices.data(), indices.size(),
+            positions, vertexCount, kPosStride, opts.maxVertices, minTriangles, opts.maxTriangles, 0.5f ) );
+    else
+        meshlets.resize( meshopt_buildMeshlets(
+            meshlets.data(), meshletVertices.data(), meshletTriangles.data(), indices.data(), indices.size(),
+            positions, vertexCount, kPosStride, opts.maxVertices, opts.maxTriangles, opts.coneWeight ) );
+
+    MeshMeshlets out;
+    out.meshlets.reserve( meshlets.size() );
+    for ( const meshopt_Meshlet& m : meshlets )
+    {
+        unsigned int*  mv = meshletVertices.data() + m.vertex_offset;
+        unsigned char* mt = meshletTriangles.data() + m.triangle_offset;
+        meshopt_optimizeMeshlet( mv, mt, m.triangle_count, m.vertex_count );
+        const meshopt_Bounds b = meshopt_computeMeshletBounds(
+            mv, mt, m.triangle_count, positions, vertexCount, kPosStride );
+
+        MeshletRecord r{};
+        std::copy_n( b.center, 3, r.center );
+        r.radius = b.radius;
+        std::copy_n( b.cone_apex, 3, r.coneApex );
+        r.coneCutoff = b.cone_cutoff;
+        std::copy_n( b.cone_axis, 3, r.coneAxis );
+        std::copy_n( b.cone_axis_s8, 3, r.coneAxisS8 );
+        r.coneCutoffS8   = b.cone_cutoff_s8;
+        r.vertexOffset   = static_cast<uint32_t>( out.vertices.size() );
+        r.triangleOffset = static_cast<uint32_t>( out.triangles.size() / 3 );
+        r.vertexCount    = m.vertex_count;
+        r.triangleCount  = m.triangle_count;
+        out.meshlets.push_back( r );
+
+        out.vertices.insert( out.vertices.end(), mv, mv + m.vertex_count );
+        out.triangles.insert( out.triangles.end(), mt, mt + m.triangle_count * 3 );
+    }
+    return out;
+}
+
+Result<MeshletInfo> writeMeshlets(
+    const aiScene* scene, const fs::path& path, const MeshletOptions& opts, ThreadPool* pool )
+{
+    if ( opts.maxVertices < 3 || opts.maxVertices > 256 || opts.maxTriangles < 1 || opts.maxTriangles > 512 )
+        return std::unexpected( Error{ ErrorCode::ExportFailed,
+            "Meshlets need 3-256 vertices and 1-512 triangles" } );
+
+    installMeshoptAllocator();
+
+    std::vector<unsigned int> meshes;
+    for ( unsigned int m = 0; m < scene->mNumMeshes; ++m )
+        if ( canSimplify( scene->mMeshes[m] ) )
+            meshes.push_back( m );
+
+    std::vector<MeshMeshlets> built( meshes.size() );
+    auto build = [&]( size_t i ) { built[i] = buildMeshlets( scene->mMeshes[meshes[i]], opts ); };
+    if ( pool )
+        pool->parallelFor( meshes.size(), build );
+    else
+        for ( size_t i = 0; i < meshes.size(); ++i )
+            build( i );
+
+    MeshletInfo info;
+    info.path = path;
+
+    MeshletFileHeader header{};
+    std::memcpy( header.magic, kMeshletMagic, sizeof( header.magic ) );
+    header.version   = kMeshletVersion;
+    header.meshCount = static_cast<uint32_t>( meshes.size() );
+
+    // Data blocks follow the entries, mesh by mesh, each 4-byte aligned.
+    std::vector<MeshletMeshEntry> entries( meshes.size() );
+    uint64_t offset = sizeof( MeshletFileHeader ) + entries.size() * sizeof( MeshletMeshEntry );
+    for ( size_t i = 0; i < meshes.size(); ++i )
+    {
+        const MeshMeshlets& b = built[i];
+        MeshletMeshEntry&   e = entries[i];
+        e.sourceMesh    = meshes[i];
+        e.meshletCount  = static_cast<uint32_t>( b.meshlets.size() );
+        e.vertexCount   = static_cast<uint32_t>( b.vertices.size() );
+        e.triangleCount = static_cast<uint32_t>( b.triangles.size() / 3 );
+
+        e.meshletOffset  = offset; offset += b.meshlets.size() * sizeof( MeshletRecord );
+        e.vertexOffset   = offset; offset += b.vertices.size() * sizeof( uint32_t );
+        e.triangleOffset = offset; offset += b.triangles.size();
+        offset = ( offset + 3 ) & ~uint64_t( 3 );
+
+        info.meshletCount += e.meshletCount;
+    }
+
+    std::ofstream out( path, std::ios::binary );
+    if ( !out )
+        return std::unexpected( Error{ ErrorCode::ExportFailed, "Could not write " + path.string() } );
+
+    auto write = [&]( const void* data, size_t bytes ) { out.write( static_cast<const char*>( data ), bytes ); };
+    write( &header, sizeof( header ) );
+    write( entries.data(), entries.size() * sizeof( MeshletMeshEntry ) );
+    for ( const MeshMeshlets& b : built )
+    {
+        write( b.meshlets.data(), b.meshlets.size() * sizeof( MeshletRecord ) );
+        write( b.vertices.data(), b.vertices.size() * sizeof( uint32_t ) );
+        write( b.triangles.data(), b.triangles.size() );
+        static constexpr char kPad[4] = {};
+        write( kPad, ( 4 - b.triangles.size() % 4 ) % 4 );
+    }
+    if ( !out.flush() )
+        return std::unexpected( Error{ ErrorCode::ExportFailed, "Could not write " + path.string() } );
+
+    return info;
+}
+
+} // namespace lodgen
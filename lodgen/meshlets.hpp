@@ -0,0 +1,82 @@
+#pragma once
+#include "types.hpp"
+#include "thread_pool.hpp"
+#include <assimp/scene.h>
+#include <cstdint>
+
+namespace lodgen
+{
+
+// Meshlets and their culling bounds for every triangle mesh of a saved LOD,
+// written next to it so a mesh-shader renderer can load them instead of
+// building them at startup.
+//
+// Meshlet vertices index the mesh's vertex buffer as lodgen exports it.
+// glTF / GLB keep that order; exporters that re-index vertices (e.g. OBJ)
+// do not, so use the sidecar with the formats that preserve it.
+
+// ── .meshlets file layout ────────────────────────────────────────────────────
+//
+// Little-endian. MeshletFileHeader, then meshCount MeshletMeshEntry, then the
+// data blocks the entries point at (byte offsets from the start of the file).
+
+inline constexpr char     kMeshletMagic[4] = { 'M', 'S', 'H', 'L' };
+inline constexpr uint32_t kMeshletVersion  = 1;
+
+struct MeshletFileHeader
+{
+    char     magic[4];
+    uint32_t version;
+    uint32_t meshCount;
+    uint32_t reserved;
+};
+
+struct MeshletMeshEntry
+{
+    uint32_t sourceMesh;      // index into the scene's mMeshes
+    uint32_t meshletCount;
+    uint32_t vertexCount;     // meshlet vertex references
+    uint32_t triangleCount;
+    uint64_t meshletOffset;   // MeshletRecord[meshletCount]
+    uint64_t vertexOffset;    // uint32_t[vertexCount], into the mesh vertices
+    uint64_t triangleOffset;  // uint8_t[3 * triangleCount], into a meshlet's vertices
+};
+
+struct MeshletRecord
+{
+    float    center[3];       // bounding sphere
+    float    radius;
+    float    coneApex[3];     // backface cone (see meshopt_Bounds)
+    float    coneCutoff;
+    float    coneAxis[3];
+    int8_t   coneAxisS8[3];   // the same cone, snorm8
+    int8_t   coneCutoffS8;
+    uint32_t vertexOffset;    // first meshlet vertex
+    uint32_t triangleOffset;  // first meshlet triangle
+    uint32_t vertexCount;
+    uint32_t triangleCount;
+};
+
+static_assert( sizeof( MeshletMeshEntry ) == 40 && sizeof( MeshletRecord ) == 64 );
+
+struct MeshletOptions
+{
+    unsigned int maxVertices  = 64;    // per meshlet, <= 256
+    unsigned int maxTriangles = 124;   // per meshlet, <= 512
+    bool         spatial      = false; // meshopt_buildMeshletsSpatial: tighter boxes for ray tracing
+    float        coneWeight   = 0.25f; // meshopt_buildMeshlets: favour narrow cones for backface culling
+};
+
+struct MeshletInfo
+{
+    fs::path     path;
+    unsigned int meshletCount = 0; // over all meshes
+};
+
+// Build meshlets (optimized with meshopt_optimizeMeshlet) and bounds for every
+// triangle mesh of `scene` and write them to `path`. With a pool, meshes are
+// processed concurrently.
+Result<MeshletInfo> writeMeshlets(
+    const aiScene* scene, const fs::path& path, const MeshletOptions& opts = {}, ThreadPool* pool = nullptr );
+
+} // namespace lodgen
@@ -0,0 +1,227 @@
+#include "polyline_simplifier.hpp"
+#include "scratch_arena.hpp"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace lodgen
+{
+
+static constexpr float kKeep = std::numeric_limits<float>::infinity();
+
+// Distance of point p from segment ab (from a when the segment is degenerate).
+static float segmentDistance( const float* p, const float* a, const float* b )
+{
+    const float ab[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+    const float ap[3] = { p[0] - a[0], p[1] - a[1], p[2] - a[2] };
+    const float len2  = ab[0] * ab[0] + ab[1] * ab[1] + ab[2] * ab[2];
+    float t = len2 > 0 ? ( ap[0] * ab[0] + ap[1] * ab[1] + ap[2] * ab[2] ) / len2 : 0.0f;
+    t = std::clamp( t, 0.0f, 1.0f );
+    const float d[3] = { ap[0] - t * ab[0], ap[1] - t * ab[1], ap[2] - t * ab[2] };
+    return std::sqrt( d[0] * d[0] + d[1] * d[1] + d[2] * d[2] );
+}
+
+// ── Chains ───────────────────────────────────────────────────────────────────
+//
+// Vertex runs between ends / junctions (degree != 2), plus closed loops whose
+// vertices all have degree 2; a loop lists its first vertex again at the end.
+
+struct Chains
+{
+    ScratchVector<unsigned int> vertices; // all chains, back to back
+    ScratchVector<size_t>       starts;   // offset of each chain; one extra at the end
+    ScratchVector<unsigned char> closed;  // per chain
+};
+
+static Chains buildChains( std::span<const unsigned int> indices, size_t vertexCount )
+{
+    // Degenerate segments carry no shape and are dropped.
+    ScratchVector<unsigned int> edges;
+    edges.reserve( indices.size() );
+    for ( size_t i = 0; i + 1 < indices.size(); i += 2 )
+        if ( indices[i] != indices[i + 1] )
+        {
+            edges.push_back( indices[i] );
+            edges.push_back( indices[i + 1] );
+        }
+    const size_t edgeCount = edges.size() / 2;
+
+    // Incident edges of every vertex (CSR).
+    ScratchVector<unsigned int> offsets( vertexCount + 1, 0 );
+    for ( unsigned int v : edges )
+        ++offsets[v + 1];
+    for ( size_t v = 0; v < vertexCount; ++v )
+        offsets[v + 1] += offsets[v];
+    ScratchVector<unsigned int> incident( edges.size() );
+    {
+        ScratchVector<unsigned int> fill( offsets.begin(), offsets.end() - 1 );
+        for ( size_t e = 0; e < edgeCount; ++e )
+        {
+            incident[fill[edges[e * 2]]++]     = static_cast<unsigned int>( e );
+            incident[fill[edges[e * 2 + 1]]++] = static_cast<unsigned int>( e );
+        }
+    }
+    auto degree = [&]( unsigned int v ) { return offsets[v + 1] - offsets[v]; };
+
+    Chains chains;
+    chains.vertices.reserve( edgeCount * 2 );
+    ScratchVector<unsigned char> visited( edgeCount, 0 );
+
+    auto walk = [&]( unsigned int v, unsigned int e, bool closed ) {
+        chains.starts.push_back( chains.vertices.size() );
+        chains.closed.push_back( closed );
+        chains.vertices.push_back( v );
+        for ( ;; )
+        {
+            visited[e] = 1;
+            v = edges[e * 2] == v ? edges[e * 2 + 1] : edges[e * 2];
+            chains.vertices.push_back( v );
+            if ( degree( v ) != 2 )
+                return;
+            unsigned int next = ~0u;
+            for ( unsigned int k = offsets[v]; k < offsets[v + 1]; ++k )
+                if ( !visited[incident[k]] )
+                    next = incident[k];
+            if ( next == ~0u )
+                return; // back at the start of a loop
+            e = next;
+        }
+    };
+
+    for ( unsigned int v = 0; v < vertexCount; ++v )
+        if ( degree( v ) != 2 )
+            for ( unsigned int k = offsets[v]; k < offsets[v + 1]; ++k )
+                if ( !visited[incident[k]] )
+                    walk( v, incident[k], false );
+
+    // What is left forms loops.
+    for ( unsigned int e = 0; e < edgeCount; ++e )
+        if ( !visited[e] )
+            walk( edges[e * 2], e, true );
+
+    chains.starts.push_back( chains.vertices.size() );
+    return chains;
+}
+
+// ── Ranking ──────────────────────────────────────────────────────────────────
+//
+// Douglas–Peucker splits each chain at its farthest vertex from the chord,
+// recursively. The deviation found at a split is capped by that of the split
+// above it, so a vertex never outranks the vertex it depends on; keeping every
+// vertex ranked above a tolerance is then exactly Douglas–Peucker with that
+// tolerance. Splits are numbered in order, which breaks ties the same way.
+
+struct Span
+{
+    size_t lo, hi; // chain positions, both kept
+    float  cap;
+};
+
+static void rankChain( const Chains& chains, size_t c, const float* positions,
+                       std::span<float> rank, std::span<unsigned int> order, unsigned int& next,
+                       ScratchVector<Span>& stack )
+{
+    const size_t first = chains.starts[c];
+    const size_t last  = chains.starts[c + 1] - 1;
+    rank[first] = rank[last] = kKeep;
+    auto pos = [&]( size_t i ) { return positions + size_t( chains.vertices[i] ) * 3; };
+
+    stack.clear();
+    stack.push_back( { first, last, kKeep } );
+    bool loopSplit = chains.closed[c] != 0; // a loop keeps its far point
+    while ( !stack.empty() )
+    {
+        const Span s = stack.back();
+        stack.pop_back();
+        if ( s.hi - s.lo < 2 )
+            continue;
+
+        size_t split = s.lo + 1;
+        float  dist  = -1.0f;
+        for ( size_t i = s.lo + 1; i < s.hi; ++i )
+        {
+            float d = segmentDistance( pos( i ), pos( s.lo ), pos( s.hi ) );
+            if ( d > dist )
+            {
+                dist  = d;
+                split = i;
+            }
+        }
+        rank[split]  = loopSplit ? kKeep : std::min( dist, s.cap );
+        order[split] = next++;
+        loopSplit    = false;
+        stack.push_back( { split, s.hi, rank[split] } );
+        stack.push_back( { s.lo, split, rank[split] } );
+    }
+}
+
+// ── Entry point ──────────────────────────────────────────────────────────────
+
+size_t simplifyPolylines(
+    unsigned int* destination, std::span<const unsigned int> indices, const float* positions, size_t vertexCount,
+    size_t targetSegments, float maxError, float* error )
+{
+    *error = 0;
+    const Chains chains = buildChains( indices, vertexCount );
+    const size_t chainCount = chains.closed.size();
+    const size_t posCount   = chains.vertices.size();
+
+    ScratchVector<float>        rank( posCount, 0.0f );
+    ScratchVector<unsigned int> order( posCount, 0 );
+    {
+        ScratchVector<Span> stack;
+        unsigned int next = 0;
+        for ( size_t c = 0; c < chainCount; ++c )
+            rankChain( chains, c, positions, rank, order, next, stack );
+    }
+
+    // Every chain keeps its ends (one segment); each interior vertex kept adds
+    // one more. Keep the best ranked: enough for the target, and all above
+    // the error limit.
+    ScratchVector<unsigned int> interior;
+    interior.reserve( posCount );
+    size_t aboveLimit = 0;
+    for ( size_t c = 0; c < chainCount; ++c )
+        for ( size_t i = chains.starts[c] + 1; i + 1 < chains.starts[c + 1]; ++i )
+        {
+            interior.push_back( static_cast<unsigned int>( i ) );
+            aboveLimit += rank[i] == kKeep || rank[i] > maxError; // loops keep their far point
+        }
+    const size_t forTarget = targetSegments > chainCount ? targetSegments - chainCount : 0;
+    const size_t keepCount = std::min( interior.size(), std::max( forTarget, aboveLimit ) );
+
+    ScratchVector<unsigned char> keep( posCount, 0 );
+    for ( size_t c = 0; c < chainCount; ++c )
+        keep[chains.starts[c]] = keep[chains.starts[c + 1] - 1] = 1;
+    if ( keepCount > 0 )
+    {
+        auto better = [&]( unsigned int a, unsigned int b ) {
+            return rank[a] != rank[b] ? rank[a] > rank[b] : order[a] < order[b];
+        };
+        std::nth_element( interior.begin(), interior.begin() + ( keepCount - 1 ), interior.end(), better );
+        for ( size_t k = 0; k < keepCount; ++k )
+            keep[interior[k]] = 1;
+    }
+
+    // Emit the kept segments, measuring how far the dropped vertices are.
+    size_t count = 0;
+    for ( size_t c = 0; c < chainCount; ++c )
+    {
+        size_t prev = chains.starts[c];
+        for ( size_t i = prev + 1; i < chains.starts[c + 1]; ++i )
+        {
+            if ( !keep[i] )
+                continue;
+            const float* a = positions + size_t( chains.vertices[prev] ) * 3;
+            const float* b = positions + size_t( chains.vertices[i] ) * 3;
+            for ( size_t j = prev + 1; j < i; ++j )
+                *error = std::max( *error, segmentDistance( positions + size_t( chains.vertices[j] ) * 3, a, b ) );
+            destination[count++] = chains.vertices[prev];
+            destination[count++] = chains.vertices[i];
+            prev = i;
+        }
+    }
+    return count;
+}
+
+} // namespace lodgen
@@ -0,0 +1,28 @@
+#pragma once
+#include <cstddef>
+#include <span>
+
+namespace lodgen
+{
+
+// Douglas–Peucker simplification of line lists (aiPrimitiveType_LINE meshes).
+//
+// The segments are joined into polylines through every vertex shared by
+// exactly two of them; ends and junctions are always kept, and so is the far
+// point of each closed loop. Douglas–Peucker then ranks the interior vertices
+// of every polyline by the deviation they remove, and the highest ranked are
+// kept across all polylines at once until the target is met.
+
+// Simplify the line list `indices` (vertex pairs into `positions`: float3,
+// 12-byte stride) to about `targetSegments` segments, but keep every vertex
+// whose removal would move the lines by more than `maxError` (model units).
+// targetSegments 0 lets the error alone decide.
+// Writes to `destination` (room for indices.size()) pairs that still index
+// `positions` and returns the number of indices written; `error` receives the
+// largest distance of a dropped vertex from the result. Temporaries come from
+// the calling thread's ScratchArena.
+size_t simplifyPolylines(
+    unsigned int* destination, std::span<const unsigned int> indices, const float* positions, size_t vertexCount,
+    size_t targetSegments, float maxError, float* error );
+
+} // namespace lodgen
@@ -1,9 +1,12 @@
 #include "scene_io.hpp"
+#include "cow_scene.hpp"
 #include "types.hpp"
 #include <assimp/Exporter.hpp>
+#include <assimp/DefaultIOSystem.h>
 #include <assimp/Importer.hpp>
 #include <assimp/postprocess.h>
 #include <algorithm>
+#include <map>
 #include <vector>
 
 namespace lodgen
@@ -12,23 +15,45 @@ namespace lodgen
 static_assert( sizeof( ai_real ) == sizeof( float ),
                "lodgen requires assimp built with single-precision floats" );
 
+// Extension (without dot) → first matching export format id. Assimp builds its
+// exporter registry on every Exporter construction, so it is queried only once.
+static const std::map<std::string, std::string>& exportFormatIds()
+{
+    static const std::map<std::string, std::string> ids = [] {
+        std::map<std::string, std::string> m;
+        Assimp::Exporter exporter;
+        for ( size_t i = 0; i < exporter.GetExportFormatCount(); ++i )
+        {
+            const aiExportFormatDesc* desc = exporter.GetExportFormatDescription( i );
+            if ( desc )
+                m.emplace( desc->fileExtension, desc->id );
+        }
+        return m;
+    }();
+    return ids;
+}
+
 Result<std::string> findExportFormatId( const std::string& extension )
 {
     std::string ext = extension;
     if ( !ext.empty() && ext[0] == '.' )
         ext = ext.substr( 1 );
 
-    Assimp::Exporter exporter;
-    for ( size_t i = 0; i < exporter.GetExportFormatCount(); ++i )
-    {
-        const aiExportFormatDesc* desc = exporter.GetExportFormatDescription( i );
-        if ( desc && ext == desc->fileExtension )
-            return std::string( desc->id );
-    }
+    const auto& ids = exportFormatIds();
+    auto it = ids.find( ext );
+    if ( it != ids.end() )
+        return it->second;
     return std::unexpected( Error{ ErrorCode::UnsupportedFormat,
                                    "No export format for extension: " + extension } );
 }
 
+bool isImportable( const fs::path& path )
+{
+    static const Assimp::Importer importer;
+    const std::string ext = path.extension().string();
+    return !ext.empty() && importer.IsExtensionSupported( ext );
+}
+
 std::vector<std::string> supportedFormats()
 {
     std::vector<std::string> result;
@@ -42,13 +67,49 @@ std::vector<std::string> supportedFormats()
     return result;
 }
 
-Result<ScenePtr> loadScene( const fs::path& path )
+// Default file access that remembers every file the importer opened.
+// (DefaultIOSystem is final, so it is wrapped rather than extended.)
+class RecordingIOSystem : public Assimp::IOSystem
+{
+public:
+    explicit RecordingIOSystem( std::vector<fs::path>* files ) : m_files( files ) {}
+
+    bool Exists( const char* file ) const override { return m_io.Exists( file ); }
+    char getOsSeparator() const override { return m_io.getOsSeparator(); }
+    bool ComparePaths( const char* a, const char* b ) const override { return m_io.ComparePaths( a, b ); }
+    void Close( Assimp::IOStream* stream ) override { m_io.Close( stream ); }
+
+    Assimp::IOStream* Open( const char* file, const char* mode ) override
+    {
+        Assimp::IOStream* stream = m_io.Open( file, mode );
+        if ( stream )
+        {
+            fs::path p = fs::path( file ).lexically_normal();
+            if ( std::find( m_files->begin(), m_files->end(), p ) == m_files->end() )
+                m_files->push_back( std::move( p ) );
+        }
+        return stream;
+    }
+
+private:
+    Assimp::DefaultIOSystem m_io;
+    std::vector<fs::path>*  m_files;
+};
+
+static void recordReads( Assimp::Importer& importer, std::vector<fs::path>* readFiles )
+{
+    if ( readFiles )
+        importer.SetIOHandler( new RecordingIOSystem( readFiles ) ); // importer takes ownership
+}
+
+Result<ScenePtr> loadScene( const fs::path& path, std::vector<fs::path>* readFiles )
 {
     if ( !fs::exists( path ) )
         return std::unexpected( Error{ ErrorCode::FileNotFound,
                                        "File not found: " + path.string() } );
 
     Assimp::Importer importer;
+    recordReads( importer, readFiles );
     const aiScene* scene = importer.ReadFile(
         path.string(),
         aiProcess_Triangulate | aiProcess_JoinIdenticalVertices | aiProcess_SortByPType );
@@ -57,23 +118,18 @@ Result<ScenePtr> loadScene( const fs::path& path )
         return std::unexpected( Error{ ErrorCode::ImportFailed,
                                        importer.GetErrorString() } );
 
-    aiScene* copy = nullptr;
-    aiCopyScene( scene, &copy );
-
-    if ( !copy )
-        return std::unexpected( Error{ ErrorCode::SceneCopyFailed,
-                                       "aiCopyScene failed" } );
-
-    return ScenePtr( copy );
+    // Take ownership from the importer instead of copying its scene.
+    return ScenePtr( importer.GetOrphanedScene() );
 }
 
-Result<MutableScenePtr> loadSceneMutable( const fs::path& path )
+Result<MutableScenePtr> loadSceneMutable( const fs::path& path, std::vector<fs::path>* readFiles )
 {
     if ( !fs::exists( path ) )
         return std::unexpected( Error{ ErrorCode::FileNotFound,
                                        "File not found: " + path.string() } );
 
     Assimp::Importer importer;
+    recordReads( importer, readFiles );
     const aiScene* scene = importer.ReadFile(
         path.string(),
         aiProcess_Triangulate | aiProcess_JoinIdenticalVertices | aiProcess_SortByPType );
@@ -82,23 +138,19 @@ Result<MutableScenePtr> loadSceneMutable( const fs::path& path )
         return std::unexpected( Error{ ErrorCode::ImportFailed,
                                        importer.GetErrorString() } );
 
-    aiScene* copy = nullptr;
-    aiCopyScene( scene, &copy );
-
-    if ( !copy )
-        return std::unexpected( Error{ ErrorCode::SceneCopyFailed,
-                                       "aiCopyScene failed" } );
-
-    return MutableScenePtr( copy );
+    // Take ownership from the importer instead of copying its scene.
+    return MutableScenePtr( importer.GetOrphanedScene() );
 }
 
-// Remove materials from `sc` that are not referenced by any mesh.
+// Old → new index for materials of `sc` that are referenced by some mesh
+// (~0u for unreferenced ones). Empty if every material is in use.
 // Assimp's OBJ exporter always prepends a "DefaultMaterial"; stripping unused
 // materials before export keeps the MTL clean and matching the source.
-static void removeUnusedMaterials( aiScene* sc )
+static std::vector<unsigned int> usedMaterialRemap( const aiScene* sc, unsigned int& keptCount )
 {
+    keptCount = 0;
     if ( sc->mNumMaterials == 0 )
-        return;
+        return {};
 
     // Count how many meshes reference each material index.
     std::vector<unsigned int> refCount( sc->mNumMaterials, 0 );
@@ -106,31 +158,38 @@ static void removeUnusedMaterials( aiScene* sc )
         if ( sc->mMeshes[m]->mMaterialIndex < sc->mNumMaterials )
             ++refCount[sc->mMeshes[m]->mMaterialIndex];
 
-    // Build a compacted material list and a remap from old → new index.
     std::vector<unsigned int> remap( sc->mNumMaterials, ~0u );
-    std::vector<aiMaterial*>  kept;
     for ( unsigned int i = 0; i < sc->mNumMaterials; ++i )
-    {
         if ( refCount[i] > 0 )
-        {
-            remap[i] = static_cast<unsigned int>( kept.size() );
-            kept.push_back( sc->mMaterials[i] );
-        }
+            remap[i] = keptCount++;
+
+    if ( keptCount == sc->mNumMaterials )
+        return {}; // nothing to remove
+    return remap;
+}
+
+// Remove materials from `sc` that are not referenced by any mesh, in place.
+static void removeUnusedMaterials( aiScene* sc )
+{
+    unsigned int keptCount = 0;
+    auto remap = usedMaterialRemap( sc, keptCount );
+    if ( remap.empty() )
+        return;
+
+    // Build the compacted material list.
+    aiMaterial** kept = keptCount ? new aiMaterial*[keptCount] : nullptr;
+    for ( unsigned int i = 0; i < sc->mNumMaterials; ++i )
+    {
+        if ( remap[i] != ~0u )
+            kept[remap[i]] = sc->mMaterials[i];
         else
-        {
             delete sc->mMaterials[i];
-        }
     }
 
-    if ( kept.size() == sc->mNumMaterials )
-        return; // nothing removed
-
     // Install the compacted array.
     delete[] sc->mMaterials;
-    sc->mNumMaterials = static_cast<unsigned int>( kept.size() );
-    sc->mMaterials    = new aiMaterial*[kept.size()];
-    for ( size_t i = 0; i < kept.size(); ++i )
-        sc->mMaterials[i] = kept[i];
+    sc->mNumMaterials = keptCount;
+    sc->mMaterials    = kept;
 
     // Fix mesh material indices.
     for ( unsigned int m = 0; m < sc->mNumMeshes; ++m )
@@ -141,31 +200,67 @@ static void removeUnusedMaterials( aiScene* sc )
     }
 }
 
+// Same, on a copy-on-write view: dropped materials are simply not referenced,
+// and only mesh headers are copied to retarget material indices.
+static void removeUnusedMaterials( CowScene& view )
+{
+    unsigned int keptCount = 0;
+    auto remap = usedMaterialRemap( view.get(), keptCount );
+    if ( !remap.empty() )
+        view.remapMaterials( remap, keptCount );
+}
+
+// True if every mesh of `scene` holds points only (e.g. a LiDAR PLY).
+static bool isPointCloud( const aiScene* scene )
+{
+    if ( scene->mNumMeshes == 0 )
+        return false;
+    for ( unsigned int m = 0; m < scene->mNumMeshes; ++m )
+        if ( scene->mMeshes[m]->mPrimitiveTypes != aiPrimitiveType_POINT )
+            return false;
+    return true;
+}
+
+static VoidResult exportScene( const aiScene* scene, const std::string& formatId, const fs::path& path )
+{
+    // Exporters that pre-transform vertices (PLY) reject meshes without faces
+    // unless told they write a point cloud.
+    Assimp::ExportProperties props;
+    props.SetPropertyBool( AI_CONFIG_EXPORT_POINT_CLOUDS, isPointCloud( scene ) );
+
+    Assimp::Exporter exporter;
+    if ( exporter.Export( scene, formatId, path.string(), 0u, &props ) != aiReturn_SUCCESS )
+        return std::unexpected( Error{ ErrorCode::ExportFailed,
+                                       exporter.GetErrorString() } );
+    return {};
+}
+
 VoidResult saveScene( const aiScene* scene, const fs::path& path )
 {
     auto fmtResult = findExportFormatId( path.extension().string() );
     if ( !fmtResult )
         return std::unexpected( fmtResult.error() );
 
-    // Some assimp exporters cast away const and modify the scene in-place
-    // (e.g. applying node-hierarchy transforms to vertex data for OBJ/FBX).
-    // Always export from a private copy so the caller's scene is never touched.
-    aiScene* copy = nullptr;
-    aiCopyScene( scene, &copy );
-    if ( !copy )
-        return std::unexpected( Error{ ErrorCode::SceneCopyFailed,
-            "aiCopyScene failed inside saveScene" } );
-    MutableScenePtr guard( copy );
+    // Some assimp exporters modify the scene in-place (e.g. applying
+    // node-hierarchy transforms to vertex data for OBJ/FBX), but
+    // Assimp::Exporter::Export always runs them on its own deep copy. The
+    // caller's scene is therefore safe; we only need a shallow view in which
+    // unused materials (e.g. assimp's auto-added DefaultMaterial) are stripped.
+    CowScene view( scene );
+    removeUnusedMaterials( view );
 
-    // Strip unreferenced materials (e.g. assimp's auto-added DefaultMaterial).
-    removeUnusedMaterials( copy );
+    return exportScene( view.get(), *fmtResult, path );
+}
 
-    Assimp::Exporter exporter;
-    if ( exporter.Export( copy, fmtResult.value(), path.string() ) != aiReturn_SUCCESS )
-        return std::unexpected( Error{ ErrorCode::ExportFailed,
-                                       exporter.GetErrorString() } );
+VoidResult saveScene( MutableScenePtr scene, const fs::path& path )
+{
+    auto fmtResult = findExportFormatId( path.extension().string() );
+    if ( !fmtResult )
+        return std::unexpected( fmtResult.error() );
 
-    return {};
+    removeUnusedMaterials( scene.get() );
+
+    return exportScene( scene.get(), *fmtResult, path );
 }
 
-} // namespace lodgen
+} // namespace lodgen
\ No newline at end of file
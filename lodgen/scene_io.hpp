@@ -9,8 +9,22 @@ namespace lodgen
 Result<std::string> findExportFormatId( const std::string& extension );
 std::vector<std::string> supportedFormats();
 
-Result<ScenePtr>        loadScene( const fs::path& path );
-Result<MutableScenePtr> loadSceneMutable( const fs::path& path );
+// True if assimp has an importer for the file's extension (case-insensitive).
+bool isImportable( const fs::path& path );
+
+// Both loaders take ownership of the importer's scene; nothing is copied.
+// readFiles, if set, receives every file the importer opened (the model
+// itself, material libraries, buffers, ...).
+Result<ScenePtr>        loadScene( const fs::path& path, std::vector<fs::path>* readFiles = nullptr );
+Result<MutableScenePtr> loadSceneMutable( const fs::path& path, std::vector<fs::path>* readFiles = nullptr );
+
+// Export `scene` by file extension. The scene is left untouched.
 VoidResult saveScene( const aiScene* scene, const fs::path& path );
 
+// Variant for a scene the caller no longer needs: unused materials are
+// stripped in place rather than on a copy-on-write view, and the scene is
+// freed on return. The export itself still runs on assimp's own deep copy,
+// as Assimp::Exporter::Export always makes one.
+VoidResult saveScene( MutableScenePtr scene, const fs::path& path );
+
 } // namespace lodgen
@@ -0,0 +1,127 @@
+#include "scratch_arena.hpp"
+#include <meshoptimizer.h>
+#include <algorithm>
+#include <cstdint>
+#include <mutex>
+#include <new>
+
+namespace lodgen
+{
+
+ScratchArena& ScratchArena::forThread()
+{
+    static thread_local ScratchArena arena;
+    return arena;
+}
+
+void* ScratchArena::allocate( size_t bytes, size_t align )
+{
+    for ( ;; )
+    {
+        if ( m_chunk < m_chunks.size() )
+        {
+            Chunk&    c     = m_chunks[m_chunk];
+            uintptr_t base  = reinterpret_cast<uintptr_t>( c.data.get() );
+            uintptr_t start = ( base + m_offset + align - 1 ) & ~uintptr_t( align - 1 );
+            if ( start - base + bytes <= c.size )
+            {
+                m_offset = start - base + bytes;
+                return reinterpret_cast<void*>( start );
+            }
+
+            // Next chunk if it is big enough, else replace the smaller ones after us.
+            if ( m_chunk + 1 < m_chunks.size() && m_chunks[m_chunk + 1].size >= bytes + align )
+            {
+                ++m_chunk;
+                m_offset = 0;
+                continue;
+            }
+            m_chunks.resize( m_chunk + 1 );
+        }
+
+        // Growth doubles up to kRetainBytes; past that a chunk is only as big
+        // as its request, so a huge mesh does not inflate every later chunk.
+        const size_t grown = m_chunks.empty() ? 0 : std::min( m_chunks.back().size * 2, kRetainBytes );
+        size_t size = std::max( { kChunkBytes, bytes + align, grown } );
+        m_chunks.push_back( { std::make_unique_for_overwrite<std::byte[]>( size ), size } );
+        m_chunk  = m_chunks.size() - 1;
+        m_offset = 0;
+    }
+}
+
+void ScratchArena::rewind( Marker m )
+{
+    m_chunk  = m.chunk;
+    m_offset = m.offset;
+}
+
+bool ScratchArena::owns( const void* p ) const
+{
+    const auto* b = static_cast<const std::byte*>( p );
+    for ( const auto& c : m_chunks )
+        if ( b >= c.data.get() && b < c.data.get() + c.size )
+            return true;
+    return false;
+}
+
+void ScratchArena::trim()
+{
+    size_t keep  = 0;
+    size_t total = 0;
+    while ( keep < m_chunks.size() && total + m_chunks[keep].size <= kRetainBytes )
+        total += m_chunks[keep++].size;
+    m_chunks.resize( std::max( keep, m_chunk + 1 ) );
+}
+
+ScratchArena::Scope::Scope()
+    : m_arena( forThread() )
+    , m_mark( m_arena.mark() )
+{
+    ++m_arena.m_depth;
+}
+
+ScratchArena::Scope::~Scope()
+{
+    m_arena.rewind( m_mark );
+    if ( --m_arena.m_depth == 0 )
+        m_arena.trim();
+}
+
+// ── meshoptimizer hooks ───────────────────────────────────────────────────────
+//
+// meshopt frees its allocations in reverse order before each call returns, so
+// every block carries the arena position from before it and freeing it simply
+// rewinds there.
+
+struct alignas( 16 ) BlockHeader
+{
+    ScratchArena::Marker before;
+};
+
+static void* MESHOPTIMIZER_ALLOC_CALLCONV meshoptAllocate( size_t size )
+{
+    ScratchArena& arena = ScratchArena::forThread();
+    ScratchArena::Marker before = arena.mark();
+    auto* header = static_cast<BlockHeader*>( arena.allocate( sizeof( BlockHeader ) + size, alignof( BlockHeader ) ) );
+    header->before = before;
+    return header + 1;
+}
+
+static void MESHOPTIMIZER_ALLOC_CALLCONV meshoptDeallocate( void* p )
+{
+    ScratchArena& arena = ScratchArena::forThread();
+    if ( !arena.owns( p ) )
+    {
+        ::operator delete( p ); // allocated before the hooks were installed
+        return;
+    }
+    arena.rewind( ( static_cast<BlockHeader*>( p ) - 1 )->before );
+}
+
+void installMeshoptAllocator()
+{
+    static std::once_flag once;
+    std::call_once( once, [] { meshopt_setAllocator( meshoptAllocate, meshoptDeallocate ); } );
+}
+
+} // namespace lodgen
@@ -0,0 +1,98 @@
+#pragma once
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+namespace lodgen
+{
+
+// Per-thread bump allocator for short-lived simplifier buffers.
+//
+// Memory is handed out from a few large chunks and only given back when the
+// enclosing Scope ends, so simplifying thousands of small meshes reuses the
+// same chunks instead of going through malloc for every temporary.
+// meshoptimizer's internal allocations are routed here as well (see
+// installMeshoptAllocator).
+//
+// Allocations are only valid until the innermost enclosing Scope ends. When
+// the outermost Scope of a thread ends, chunks beyond kRetainBytes are freed,
+// so one huge mesh does not pin its working set for the rest of the run.
+class ScratchArena
+{
+public:
+    static constexpr size_t kChunkBytes  = size_t( 1 ) << 20;  // first chunk
+    static constexpr size_t kRetainBytes = size_t( 64 ) << 20; // kept between outermost scopes
+
+    struct Marker
+    {
+        size_t chunk  = 0;
+        size_t offset = 0;
+    };
+
+    // Rewinds the arena to where it was on construction.
+    class Scope
+    {
+    public:
+        Scope();
+        ~Scope();
+
+        Scope( const Scope& )            = delete;
+        Scope& operator=( const Scope& ) = delete;
+
+    private:
+        ScratchArena& m_arena;
+        Marker        m_mark;
+    };
+
+    static ScratchArena& forThread();
+
+    void*  allocate( size_t bytes, size_t align = alignof( std::max_align_t ) );
+    Marker mark() const { return { m_chunk, m_offset }; }
+    void   rewind( Marker m );
+    bool   owns( const void* p ) const;
+
+private:
+    struct Chunk
+    {
+        std::unique_ptr<std::byte[]> data;
+        size_t                       size = 0;
+    };
+
+    void trim();
+
+    std::vector<Chunk> m_chunks;
+    size_t             m_chunk  = 0; // chunk being bumped
+    size_t             m_offset = 0; // first free byte in it
+    unsigned int       m_depth  = 0; // open scopes
+};
+
+// std allocator over the calling thread's arena; deallocation is deferred to
+// the enclosing Scope. Only use inside a Scope, on the thread that opened it.
+template <typename T>
+struct ScratchAllocator
+{
+    using value_type = T;
+
+    ScratchArena* arena;
+
+    ScratchAllocator() : arena( &ScratchArena::forThread() ) {}
+    template <typename U>
+    ScratchAllocator( const ScratchAllocator<U>& other ) : arena( other.arena ) {}
+
+    T*   allocate( size_t n ) { return static_cast<T*>( arena->allocate( n * sizeof( T ), alignof( T ) ) ); }
+    void deallocate( T*, size_t ) {}
+
+    template <typename U>
+    bool operator==( const ScratchAllocator<U>& other ) const { return arena == other.arena; }
+};
+
+template <typename T>
+using ScratchVector = std::vector<T, ScratchAllocator<T>>;
+
+// Route meshoptimizer's allocations into the calling thread's arena. Called
+// once, before the first simplification; affects every meshopt user in the
+// process. Allocations made by meshopt outside any Scope still work and are
+// returned when meshopt frees them.
+void installMeshoptAllocator();
+
+} // namespace lodgen
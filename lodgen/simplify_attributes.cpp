@@ -0,0 +1,155 @@
+#include "simplify_attributes.hpp"
+#include <meshoptimizer.h>
+
+namespace lodgen
+{
+
+static constexpr unsigned int kMaxUVChannels = AI_MAX_NUMBER_OF_TEXTURECOORDS;
+static constexpr unsigned int kMaxColorChannels = AI_MAX_NUMBER_OF_COLOR_SETS;
+
+// ── Mesh layout detection ────────────────────────────────────────────────────
+
+struct MeshLayout
+{
+    bool hasNormals = false;
+    bool hasTangents = false;
+    unsigned int uvChannels = 0;
+    unsigned int colorChannels = 0;
+};
+
+static MeshLayout detectLayout( const aiMesh* mesh )
+{
+    MeshLayout layout;
+    layout.hasNormals = ( mesh->mNormals != nullptr );
+    layout.hasTangents = ( mesh->mTangents != nullptr );
+
+    for ( unsigned int ch = 0; ch < kMaxUVChannels; ++ch )
+    {
+        if ( !mesh->mTextureCoords[ch] ) break;
+        ++layout.uvChannels;
+    }
+    for ( unsigned int ch = 0; ch < kMaxColorChannels; ++ch )
+    {
+        if ( !mesh->mColors[ch] ) break;
+        ++layout.colorChannels;
+    }
+    return layout;
+}
+
+// ── Build attribute arrays for meshopt_simplifyWithAttributes ─────────────────
+//
+// Also subject to stride <= 256 and attribute_count <= kMaxAttributes (16).
+// With 8 UV channels * 2 + 3 normals = 19 — exceeds kMaxAttributes.
+// So we cap to the first few UV channels that matter most and normals.
+
+static constexpr size_t kMeshoptMaxAttributes = 32; // meshoptimizer hard limit (attribute_count must be <= 32)
+
+
+// ── Seams ────────────────────────────────────────────────────────────────────
+//
+// meshopt already welds vertices by position internally: a vertex split only
+// by its attributes is a seam vertex, which may only collapse along its seam.
+// That keeps every UV island and hard edge at full resolution, so meshes
+// with many of them stall far above their target. meshopt_SimplifyPermissive
+// lifts the restriction for every vertex not flagged Protect.
+
+// Protect every vertex whose position is shared with a vertex of another UV:
+// texture islands keep their borders, normal and colour seams may collapse.
+static void protectUVSeams( const aiMesh* mesh, unsigned int uvChannels, ScratchVector<unsigned char>& flags )
+{
+    const size_t N = mesh->mNumVertices;
+    ScratchVector<unsigned int> positionOf( N );
+    meshopt_generatePositionRemap( positionOf.data(), positionsOf( mesh ), N, kPosStride );
+
+    // Equal UVs are transitive, so comparing with the position's first vertex suffices.
+    ScratchVector<unsigned char> seam( N, 0 );
+    for ( size_t v = 0; v < N; ++v )
+    {
+        const unsigned int p = positionOf[v];
+        for ( unsigned int ch = 0; ch < uvChannels && p != v; ++ch )
+            if ( mesh->mTextureCoords[ch][v] != mesh->mTextureCoords[ch][p] )
+                seam[p] = 1;
+    }
+
+    flags.resize( N );
+    for ( size_t v = 0; v < N; ++v )
+        flags[v] = seam[positionOf[v]] ? meshopt_SimplifyVertex_Protect : 0;
+}
+
+SimplifyAttributes buildSimplifyAttributes( const aiMesh* mesh, SeamMode seams )
+{
+    const MeshLayout layout = detectLayout( mesh );
+    SimplifyAttributes attrs{};
+
+    if ( seams != SeamMode::Keep )
+    {
+        attrs.options = meshopt_SimplifyPermissive;
+        if ( seams == SeamMode::WeldNormals && layout.uvChannels > 0 )
+            protectUVSeams( mesh, layout.uvChannels, attrs.vertexFlags );
+    }
+
+    // Budget: 2 floats per UV channel + 3 for normals, capped at kMeshoptMaxAttributes
+    unsigned int uvChansToUse = layout.uvChannels;
+    size_t needed = uvChansToUse * 2 + ( layout.hasNormals ? 3 : 0 );
+
+    // If we exceed the limit, reduce UV channels (normals cost 3 slots)
+    while ( needed > kMeshoptMaxAttributes && uvChansToUse > 0 )
+    {
+        --uvChansToUse;
+        needed = uvChansToUse * 2 + ( layout.hasNormals ? 3 : 0 );
+    }
+    // If still over (unlikely: 0 UVs + 3 normals = 3), drop normals
+    bool useNormals = layout.hasNormals && ( needed <= kMeshoptMaxAttributes );
+
+    size_t count = uvChansToUse * 2 + ( useNormals ? 3 : 0 );
+
+    attrs.count = count;
+    attrs.stride = count * sizeof( float );
+
+    if ( count == 0 )
+        return attrs;
+
+    // Also check stride <= 256
+    if ( attrs.stride > 256 )
+    {
+        // Shouldn't happen with 16 attrs * 4 bytes = 64 bytes, but guard anyway
+        attrs = {};
+        return attrs;
+    }
+
+    size_t N = mesh->mNumVertices;
+    attrs.data.resize( N * count );
+    attrs.weights.resize( count );
+
+    size_t offset = 0;
+
+    for ( unsigned int ch = 0; ch < uvChansToUse; ++ch )
+    {
+        for ( size_t i = 0; i < N; ++i )
+        {
+            attrs.data[i * count + offset + 0] = mesh->mTextureCoords[ch][i].x;
+            attrs.data[i * count + offset + 1] = mesh->mTextureCoords[ch][i].y;
+        }
+        // First UV channel gets highest weight (usually the one that matters)
+        attrs.weights[offset + 0] = ( ch == 0 ) ? 1.5f : 0.8f;
+        attrs.weights[offset + 1] = ( ch == 0 ) ? 1.5f : 0.8f;
+        offset += 2;
+    }
+
+    if ( useNormals )
+    {
+        for ( size_t i = 0; i < N; ++i )
+        {
+            attrs.data[i * count + offset + 0] = mesh->mNormals[i].x;
+            attrs.data[i * count + offset + 1] = mesh->mNormals[i].y;
+            attrs.data[i * count + offset + 2] = mesh->mNormals[i].z;
+        }
+        attrs.weights[offset + 0] = 0.5f;
+        attrs.weights[offset + 1] = 0.5f;
+        attrs.weights[offset + 2] = 0.5f;
+    }
+
+    return attrs;
+}
+
+} // namespace lodgen
@@ -0,0 +1,38 @@
+#pragma once
+#include "mesh_simplifier.hpp"
+#include "scratch_arena.hpp"
+#include <assimp/mesh.h>
+
+namespace lodgen
+{
+
+// Vertex data handed to meshopt by the simplifier and the cluster LOD builder.
+
+// aiVector3D is three tightly packed floats (ai_real is float, checked in
+// scene_io.cpp), so mVertices is passed to meshopt as-is with a 12-byte stride.
+
+inline constexpr size_t kPosStride = sizeof( aiVector3D ); // 12 bytes
+
+inline const float* positionsOf( const aiMesh* mesh )
+{
+    return reinterpret_cast<const float*>( mesh->mVertices );
+}
+
+struct SimplifyAttributes
+{
+    ScratchVector<float> data;
+    ScratchVector<float> weights;
+    size_t             stride;     // bytes
+    size_t             count;      // components per vertex
+
+    ScratchVector<unsigned char> vertexFlags; // meshopt_SimplifyVertex_* per vertex; empty for none
+    unsigned int                 options = 0; // meshopt_Simplify* flags the seam mode adds
+};
+
+// Weighted UVs and normals of `mesh` for meshopt_simplifyWithAttributes
+// (count 0 if it has neither), and the flags that implement `seams`. The
+// buffers come from the calling thread's ScratchArena, so use them inside
+// the caller's Scope.
+SimplifyAttributes buildSimplifyAttributes( const aiMesh* mesh, SeamMode seams = SeamMode::Keep );
+
+} // namespace lodgen
@@ -0,0 +1,29 @@
+#pragma once
+#include <chrono>
+
+namespace lodgen
+{
+
+// Wall-clock seconds for stage metrics.
+class Stopwatch
+{
+public:
+    double elapsed() const
+    {
+        return std::chrono::duration<double>( std::chrono::steady_clock::now() - m_start ).count();
+    }
+
+    // Seconds since construction or the previous lap; restarts the watch.
+    double lap()
+    {
+        auto now = std::chrono::steady_clock::now();
+        double s = std::chrono::duration<double>( now - m_start ).count();
+        m_start  = now;
+        return s;
+    }
+
+private:
+    std::chrono::steady_clock::time_point m_start = std::chrono::steady_clock::now();
+};
+
+} // namespace lodgen
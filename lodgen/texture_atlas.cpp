@@ -122,7 +122,7 @@ Result<std::vector<AtlasInfo>> buildAtlas( aiScene* scene, const AtlasOptions& o
     struct Source
     {
         DecodedTexture decoded;
-        fs::path       externalPath; // non-empty if loaded from disk (for cleanup)
+        fs::path       externalPath; // non-empty if loaded from outputDir (for cleanup)
     };
 
     std::map<std::string, unsigned int> keyToSource; // raw path -> sources[] index
@@ -158,7 +158,13 @@ Result<std::vector<AtlasInfo>> buildAtlas( aiScene* scene, const AtlasOptions& o
                 {
                     Source src;
                     const aiTexture* embedded = scene->GetEmbeddedTexture( key.c_str() );
-                    if ( embedded )
+                    auto preDecoded = opts.decoded ? opts.decoded->find( key ) : DecodedTextureMap::const_iterator{};
+                    if ( opts.decoded && preDecoded != opts.decoded->end() )
+                    {
+                        // Handed over in memory by an earlier stage
+                        src.decoded = *preDecoded->second;
+                    }
+                    else if ( embedded )
                     {
                         auto dec = decodeTexture( embedded );
                         if ( !dec ) return std::unexpected( dec.error() );
@@ -169,11 +175,14 @@ Result<std::vector<AtlasInfo>> buildAtlas( aiScene* scene, const AtlasOptions& o
                         // Prefer resized copy in outputDir, fall back to original in modelDir
                         fs::path fromOutput = opts.outputDir / fs::path( key ).filename();
                         fs::path fromModel  = opts.modelDir  / fs::path( key ).filename();
-                        fs::path filePath   = fs::exists( fromOutput ) ? fromOutput : fromModel;
+                        const bool inOutput = fs::exists( fromOutput );
+                        fs::path filePath   = inOutput ? fromOutput : fromModel;
                         auto dec = loadExternalTexture( filePath );
                         if ( !dec ) return std::unexpected( dec.error() );
-                        src.decoded      = std::move( *dec );
-                        src.externalPath = filePath;
+                        src.decoded = std::move( *dec );
+                        // Source textures in modelDir are the user's input — never remove them
+                        if ( inOutput )
+                            src.externalPath = filePath;
                     }
                     unsigned int idx = static_cast<unsigned int>( sources.size() );
                     keyToSource[key] = idx;
@@ -11,6 +11,7 @@ struct AtlasOptions
 {
     fs::path modelDir;  // source model directory — to resolve external texture paths
     fs::path outputDir; // where atlas_<type>.png files are written
+    const DecodedTextureMap* decoded = nullptr; // material path -> image, tried before embedded / disk
 };
 
 struct AtlasInfo
@@ -38,8 +39,9 @@ struct AtlasInfo
 //
 // External texture files that were baked into atlases are removed from outputDir.
 //
-// Precondition: processTextures may have already run (external files in outputDir)
-//               or not (original files in modelDir are used directly).
+// Precondition: processTextures may have already run (external files in outputDir,
+//               or in memory via opts.decoded) or not (original files in modelDir
+//               are used directly).
 Result<std::vector<AtlasInfo>> buildAtlas( aiScene* scene, const AtlasOptions& opts );
 
 } // namespace lodgen
@@ -1,8 +1,10 @@
 #include "texture_processor.hpp"
+#include "stopwatch.hpp"
 #include <assimp/material.h>
 #include <stb_image.h>
 #include <stb_image_resize2.h>
 #include <stb_image_write.h>
+#include <algorithm>
 #include <cstring>
 #include <fstream>
 #include <map>
@@ -117,8 +119,125 @@ Result<DecodedTexture> loadExternalTexture( const fs::path& path )
     return out;
 }
 
+// ── texture cache ─────────────────────────────────────────────────────────────
+
+static void scaledSize( const DecodedTexture& src, float ratio, int& w, int& h )
+{
+    w = std::max( 1, static_cast<int>( src.width  * ratio ) );
+    h = std::max( 1, static_cast<int>( src.height * ratio ) );
+}
+
+TextureCache::TextureCache( std::vector<float> ratios )
+    : m_ratios( std::move( ratios ) )
+{
+    std::sort( m_ratios.begin(), m_ratios.end(), std::greater<float>() );
+    m_ratios.erase( std::unique( m_ratios.begin(), m_ratios.end() ), m_ratios.end() );
+}
+
+Result<std::shared_ptr<const DecodedTexture>> TextureCache::get(
+    const std::string& key, float ratio, const Loader& load )
+{
+    std::shared_ptr<Entry> entry;
+    {
+        std::lock_guard lock( m_mutex );
+        auto& slot = m_entries[key];
+        if ( !slot )
+            slot = std::make_shared<Entry>();
+        entry = slot;
+    }
+
+    // Other keys stay available while this one is decoded and resized.
+    std::lock_guard lock( entry->mutex );
+
+    if ( !entry->loaded )
+    {
+        entry->loaded = true;
+
+        auto decoded = load();
+        if ( !decoded )
+        {
+            entry->failed = true;
+            entry->error  = decoded.error();
+            return std::unexpected( entry->error );
+        }
+        entry->source = std::make_shared<const DecodedTexture>( std::move( *decoded ) );
+
+        // Progressive chain: each level is resized from the one above it.
+        std::shared_ptr<const DecodedTexture> base = entry->source;
+        for ( float r : m_ratios )
+        {
+            int w = 0, h = 0;
+            scaledSize( *entry->source, r, w, h );
+            if ( w != base->width || h != base->height )
+            {
+                auto resized = resizeTexture( *base, w, h );
+                if ( !resized )
+                {
+                    entry->failed = true;
+                    entry->error  = resized.error();
+                    return std::unexpected( entry->error );
+                }
+                base = std::make_shared<const DecodedTexture>( std::move( *resized ) );
+            }
+            entry->levels.push_back( base );
+        }
+    }
+
+    if ( entry->failed )
+        return std::unexpected( entry->error );
+
+    auto it = std::find( m_ratios.begin(), m_ratios.end(), ratio );
+    if ( it != m_ratios.end() )
+        return entry->levels[static_cast<size_t>( it - m_ratios.begin() )];
+
+    int w = 0, h = 0;
+    scaledSize( *entry->source, ratio, w, h );
+    auto resized = resizeTexture( *entry->source, w, h );
+    if ( !resized )
+        return std::unexpected( resized.error() );
+    return std::make_shared<const DecodedTexture>( std::move( *resized ) );
+}
+
 // ── helpers ──────────────────────────────────────────────────────────────────
 
+// Decode via `load` and scale by `ratio`, through the cache when there is one.
+static Result<std::shared_ptr<const DecodedTexture>> loadResized(
+    TextureCache* cache, const std::string& key, float ratio, const TextureCache::Loader& load )
+{
+    if ( cache )
+        return cache->get( key, ratio, load );
+
+    auto decoded = load();
+    if ( !decoded )
+        return std::unexpected( decoded.error() );
+
+    int newW = 0, newH = 0;
+    scaledSize( *decoded, ratio, newW, newH );
+    auto resized = resizeTexture( *decoded, newW, newH );
+    if ( !resized )
+        return std::unexpected( resized.error() );
+    return std::make_shared<const DecodedTexture>( std::move( *resized ) );
+}
+
+// loadResized, adding its time to `stats`: the loader's own time as decode,
+// the rest (resizing, or waiting for another LOD's chain) as resize.
+static Result<std::shared_ptr<const DecodedTexture>> loadTimed(
+    TextureCache* cache, const std::string& key, float ratio, const TextureCache::Loader& load,
+    TextureStats& stats )
+{
+    double decodeSeconds = 0;
+    Stopwatch watch;
+    auto result = loadResized( cache, key, ratio, [&]() {
+        Stopwatch decodeWatch;
+        auto decoded  = load();
+        decodeSeconds = decodeWatch.elapsed();
+        return decoded;
+    } );
+    stats.decodeSeconds += decodeSeconds;
+    stats.resizeSeconds += watch.elapsed() - decodeSeconds;
+    return result;
+}
+
 // Replace the pixel data of an embedded aiTexture with a freshly encoded blob.
 // mHeight stays 0 (compressed convention), mWidth = new byte count.
 static VoidResult replaceEmbeddedBlob(
@@ -162,7 +281,8 @@ static Result<std::string> writeExternalFile(
 
 // ── main entry point ──────────────────────────────────────────────────────────
 
-Result<TextureStats> processTextures( aiScene* scene, float ratio, const TextureOptions& opts )
+Result<TextureStats> processTextures(
+    aiScene* scene, float ratio, const TextureOptions& opts, TextureCache* cache )
 {
     TextureStats stats;
 
@@ -175,21 +295,21 @@ Result<TextureStats> processTextures( aiScene* scene, float ratio, const Texture
 
         ++stats.inputCount;
 
-        auto decoded = decodeTexture( tex );
-        if ( !decoded )
-            return std::unexpected( decoded.error() );
-
-        int newW = std::max( 1, static_cast<int>( decoded->width  * ratio ) );
-        int newH = std::max( 1, static_cast<int>( decoded->height * ratio ) );
-        auto resized = resizeTexture( *decoded, newW, newH );
+        auto resized = loadTimed( cache, "*" + std::to_string( i ), ratio,
+                                  [tex] { return decodeTexture( tex ); }, stats );
         if ( !resized )
             return std::unexpected( resized.error() );
 
-        std::string hint = decoded->formatHint.empty() ? "png" : decoded->formatHint;
+        std::string hint = ( *resized )->formatHint.empty() ? "png" : ( *resized )->formatHint;
 
-        auto r = replaceEmbeddedBlob( tex, *resized, hint );
+        Stopwatch encodeWatch;
+        auto r = replaceEmbeddedBlob( tex, **resized, hint );
         if ( !r )
             return std::unexpected( r.error() );
+        stats.encodeSeconds += encodeWatch.elapsed();
+
+        if ( opts.resized )
+            ( *opts.resized )["*" + std::to_string( i )] = *resized;
 
         // Give the embedded texture a filename so exporters (e.g. glTF) can
         // name the file; use the existing name if already set.
@@ -233,29 +353,35 @@ Result<TextureStats> processTextures( aiScene* scene, float ratio, const Texture
                 {
                     ++stats.inputCount;
 
-                    fs::path srcFile = opts.modelDir / rawPath;
-                    auto decoded = loadExternalTexture( srcFile );
-                    if ( !decoded )
-                        return std::unexpected( decoded.error() );
-
-                    int newW = std::max( 1, static_cast<int>( decoded->width  * ratio ) );
-                    int newH = std::max( 1, static_cast<int>( decoded->height * ratio ) );
-                    auto resized = resizeTexture( *decoded, newW, newH );
+                    fs::path srcFile = ( opts.modelDir / rawPath ).lexically_normal();
+                    auto resized = loadTimed( cache, srcFile.string(), ratio,
+                                              [&srcFile] { return loadExternalTexture( srcFile ); }, stats );
                     if ( !resized )
                         return std::unexpected( resized.error() );
 
-                    std::string hint = decoded->formatHint.empty() ? "png" : decoded->formatHint;
-                    auto encoded = encodeTexture( *resized, hint );
-                    if ( !encoded )
-                        return std::unexpected( encoded.error() );
-
                     // Keep original filename, write into outputDir
                     fs::path destPath = opts.outputDir / fs::path( rawPath ).filename();
-                    auto nameResult = writeExternalFile( *encoded, destPath );
-                    if ( !nameResult )
-                        return std::unexpected( nameResult.error() );
-
-                    pathToOutputName[rawPath] = *nameResult;
+                    std::string outName = destPath.filename().string();
+
+                    if ( opts.writeExternalFiles )
+                    {
+                        Stopwatch encodeWatch;
+                        std::string hint = ( *resized )->formatHint.empty() ? "png" : ( *resized )->formatHint;
+                        auto encoded = encodeTexture( **resized, hint );
+                        if ( !encoded )
+                            return std::unexpected( encoded.error() );
+
+                        auto nameResult = writeExternalFile( *encoded, destPath );
+                        if ( !nameResult )
+                            return std::unexpected( nameResult.error() );
+                        stats.bytesWritten  += encoded->size();
+                        stats.encodeSeconds += encodeWatch.elapsed();
+                    }
+
+                    if ( opts.resized )
+                        ( *opts.resized )[outName] = *resized;
+
+                    pathToOutputName[rawPath] = outName;
                     ++stats.outputCount;
                     it = pathToOutputName.find( rawPath );
                 }
@@ -2,6 +2,11 @@
 #include "types.hpp"
 #include <assimp/scene.h>
 #include <assimp/material.h>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
 #include <vector>
 #include <string>
 
@@ -32,11 +37,19 @@ inline constexpr aiTextureType kTextureTypes[] = {
     aiTextureType_TRANSMISSION,
 };
 
+struct DecodedTexture;
+
+// Material texture path -> decoded image, for handing textures between stages
+// without a trip through disk.
+using DecodedTextureMap = std::map<std::string, std::shared_ptr<const DecodedTexture>>;
+
 struct TextureOptions
 {
     bool     resizeTextures = true; // downscale proportional to mesh ratio
     fs::path modelDir;              // source model directory — for resolving external texture paths
     fs::path outputDir;             // LOD output directory — resized external files are written here
+    bool     writeExternalFiles = true;   // false: only update material paths (a later stage consumes them)
+    DecodedTextureMap* resized = nullptr; // if set, receives every resized texture by its new material path
 };
 
 struct TextureStats
@@ -45,6 +58,10 @@ struct TextureStats
     unsigned int outputCount = 0; // 1 if atlased
     unsigned int atlasWidth  = 0;
     unsigned int atlasHeight = 0;
+    uint64_t     bytesWritten  = 0; // external texture files
+    double       decodeSeconds = 0; // wall time in this call; shared decodes count where they ran
+    double       resizeSeconds = 0;
+    double       encodeSeconds = 0; // encode and, for external textures, write
 };
 
 struct DecodedTexture
@@ -60,10 +77,48 @@ Result<DecodedTexture> resizeTexture( const DecodedTexture& src, int newW, int n
 Result<std::vector<unsigned char>> encodeTexture( const DecodedTexture& tex, const std::string& hint );
 Result<DecodedTexture> loadExternalTexture( const fs::path& path );
 
+// Decoded textures shared by every LOD of one generateLods call.
+//
+// Keyed by the resolved source path of an external texture, or "*<index>" for
+// an embedded one. The first request for a key decodes the source once and
+// builds the whole chain of sizes for the known ratios, largest first, each
+// level resized from the previous one. Every later request, from any LOD, is
+// served from that chain, so results do not depend on LOD order.
+// Safe to use from concurrent LOD jobs.
+class TextureCache
+{
+public:
+    using Loader = std::function<Result<DecodedTexture>()>;
+
+    explicit TextureCache( std::vector<float> ratios );
+
+    // `key` scaled by `ratio` relative to its source. A ratio outside the
+    // chain is resized straight from the decoded source and not cached.
+    Result<std::shared_ptr<const DecodedTexture>> get(
+        const std::string& key, float ratio, const Loader& load );
+
+private:
+    struct Entry
+    {
+        std::mutex                                         mutex;
+        bool                                               loaded = false;
+        Error                                              error{};
+        bool                                               failed = false;
+        std::shared_ptr<const DecodedTexture>              source;
+        std::vector<std::shared_ptr<const DecodedTexture>> levels; // parallel to m_ratios
+    };
+
+    std::vector<float>                            m_ratios; // unique, descending
+    std::mutex                                    m_mutex;
+    std::map<std::string, std::shared_ptr<Entry>> m_entries;
+};
+
 // Processes all textures referenced by materials:
 //   - Embedded textures (*N): resized in-place, stay embedded, mFilename set for exporters.
 //   - External textures (file paths): resized and written to opts.outputDir,
 //     material paths updated to the new relative filename (stays external).
-Result<TextureStats> processTextures( aiScene* scene, float ratio, const TextureOptions& opts );
+// With a cache, sources are decoded once per cache instead of once per call.
+Result<TextureStats> processTextures(
+    aiScene* scene, float ratio, const TextureOptions& opts, TextureCache* cache = nullptr );
 
 } // namespace lodgen
@@ -0,0 +1,173 @@
+#include "thread_pool.hpp"
+#include <algorithm>
+
+namespace lodgen
+{
+
+// Which pool the current thread works for, and its queue slot in that pool.
+static thread_local const ThreadPool* tl_pool = nullptr;
+static thread_local unsigned int      tl_slot = 0;
+// Batch of the job the current thread is running, if any (of any pool).
+static thread_local const void*       tl_batch = nullptr;
+
+ThreadPool::ThreadPool( unsigned int threads )
+{
+    if ( threads == 0 )
+        threads = std::max( 1u, std::thread::hardware_concurrency() );
+
+    // The thread calling parallelFor is the remaining worker; it uses the
+    // last queue, which is shared by every thread outside the pool.
+    for ( unsigned int i = 0; i < threads; ++i )
+        m_queues.push_back( std::make_unique<Queue>() );
+
+    m_workers.reserve( threads - 1 );
+    for ( unsigned int i = 0; i + 1 < threads; ++i )
+        m_workers.emplace_back( [this, i] { workerLoop( i ); } );
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard lock( m_mutex );
+        m_stop = true;
+    }
+    m_cv.notify_all();
+    for ( auto& t : m_workers )
+        t.join();
+}
+
+unsigned int ThreadPool::currentSlot() const
+{
+    return tl_pool == this ? tl_slot : static_cast<unsigned int>( m_queues.size() - 1 );
+}
+
+// Pop from our own queue first, then steal from the front of the others.
+// With `within`, only tasks of that batch or of batches nested in it qualify;
+// those are all queued ahead of the first top-level task.
+bool ThreadPool::tryPop( unsigned int slot, const Batch* within, Task& out )
+{
+    auto qualifies = [&]( const Batch* b ) {
+        for ( ; b; b = b->parent )
+            if ( b == within )
+                return true;
+        return false;
+    };
+
+    const size_t n = m_queues.size();
+    for ( size_t k = 0; k < n; ++k )
+    {
+        Queue& q = *m_queues[( slot + k ) % n];
+        std::lock_guard lock( q.mutex );
+        for ( auto it = q.tasks.begin(); it != q.tasks.end(); ++it )
+        {
+            if ( within && !qualifies( it->batch ) )
+            {
+                if ( !it->batch->parent && within->parent )
+                    break; // top-level tasks from here on
+                continue;
+            }
+            out = *it;
+            q.tasks.erase( it );
+            return true;
+        }
+    }
+    return false;
+}
+
+bool ThreadPool::runNext( unsigned int slot, const Batch* within )
+{
+    Task task;
+    if ( !tryPop( slot, within, task ) )
+        return false;
+    m_pending.fetch_sub( 1 );
+
+    const void* outer = tl_batch;
+    tl_batch = task.batch;
+    ( *task.batch->fn )( task.index );
+    tl_batch = outer;
+
+    // The batch may be gone as soon as `done` reaches its count.
+    const size_t count = task.batch->count;
+    if ( task.batch->done.fetch_add( 1 ) + 1 == count )
+    {
+        // Lock before notifying so a waiter cannot miss the final completion.
+        { std::lock_guard lock( m_mutex ); }
+        m_cv.notify_all();
+    }
+    return true;
+}
+
+void ThreadPool::workerLoop( unsigned int slot )
+{
+    tl_pool = this;
+    tl_slot = slot;
+
+    for ( ;; )
+    {
+        if ( runNext( slot ) )
+            continue;
+
+        std::unique_lock lock( m_mutex );
+        m_cv.wait( lock, [&] { return m_stop || m_pending.load() > 0; } );
+        if ( m_stop )
+            return;
+    }
+}
+
+void ThreadPool::parallelFor( size_t count, const std::function<void( size_t )>& fn )
+{
+    if ( count == 0 )
+        return;
+
+    if ( m_workers.empty() || count == 1 )
+    {
+        for ( size_t i = 0; i < count; ++i )
+            fn( i );
+        return;
+    }
+
+    // Lives on our stack: every task referencing it has run before we return.
+    Batch batch;
+    batch.fn     = &fn;
+    batch.parent = static_cast<const Batch*>( tl_batch );
+    batch.count  = count;
+
+    // Nested batches go ahead of everything queued, in index order; top-level
+    // ones behind it.
+    const unsigned int slot = currentSlot();
+    const size_t       n    = m_queues.size();
+    m_pending.fetch_add( count );
+    for ( size_t q = 0; q < n && q < count; ++q )
+    {
+        Queue& queue = *m_queues[( slot + q ) % n];
+        std::lock_guard lock( queue.mutex );
+        if ( batch.parent )
+        {
+            const size_t last = q + ( count - 1 - q ) / n * n;
+            for ( size_t i = last + n; i > q; i -= n )
+                queue.tasks.push_front( { &batch, i - n } );
+        }
+        else
+            for ( size_t i = q; i < count; i += n )
+                queue.tasks.push_back( { &batch, i } );
+    }
+    {
+        std::lock_guard lock( m_mutex );
+        m_pushes.fetch_add( 1 );
+    }
+    m_cv.notify_all();
+
+    // Only our own tasks (and nested ones) can show up for us; wait for new
+    // tasks rather than for any pending ones.
+    while ( batch.done.load() < count )
+    {
+        const uint64_t pushes = m_pushes.load();
+        if ( runNext( slot, &batch ) )
+            continue;
+
+        std::unique_lock lock( m_mutex );
+        m_cv.wait( lock, [&] { return batch.done.load() >= count || m_pushes.load() != pushes; } );
+    }
+}
+
+} // namespace lodgen
@@ -0,0 +1,82 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace lodgen
+{
+
+// Fixed-size work-stealing pool for independent LOD / mesh jobs.
+//
+// parallelFor deals its indices round-robin onto per-thread queues, starting
+// with the caller's own. Every thread drains its queue front-to-back and then
+// steals from the front of the others, so indices submitted in descending cost
+// order are started largest-first everywhere.
+//
+// parallelFor blocks until every index has run. The calling thread runs jobs
+// while it waits, so a job may itself call parallelFor on the same pool without
+// deadlocking. While waiting it only runs jobs of its own call or of calls
+// nested in them, never unrelated queued work: a batch of models nesting LOD
+// and mesh jobs thus has at most one model in flight per thread, and stack
+// depth follows the nesting. Nested jobs are queued ahead of top-level ones,
+// so idle workers also finish started models before beginning new ones.
+// Jobs must not throw.
+class ThreadPool
+{
+public:
+    // threads == 0 picks std::thread::hardware_concurrency().
+    // threads == 1 spawns nothing; parallelFor then runs inline.
+    explicit ThreadPool( unsigned int threads = 0 );
+    ~ThreadPool();
+
+    ThreadPool( const ThreadPool& )            = delete;
+    ThreadPool& operator=( const ThreadPool& ) = delete;
+
+    // Number of threads that execute jobs, including the calling thread.
+    unsigned int size() const { return static_cast<unsigned int>( m_workers.size() ) + 1; }
+
+    void parallelFor( size_t count, const std::function<void( size_t )>& fn );
+
+private:
+    struct Batch
+    {
+        const std::function<void( size_t )>* fn     = nullptr;
+        const Batch*                         parent = nullptr; // batch of the job that called parallelFor
+        size_t                               count  = 0;
+        std::atomic<size_t>                  done{ 0 };
+    };
+
+    struct Task
+    {
+        Batch* batch;
+        size_t index;
+    };
+
+    struct Queue
+    {
+        std::mutex       mutex;
+        std::deque<Task> tasks;
+    };
+
+    unsigned int currentSlot() const;
+    bool         tryPop( unsigned int slot, const Batch* within, Task& out );
+    bool         runNext( unsigned int slot, const Batch* within = nullptr );
+    void         workerLoop( unsigned int slot );
+
+    std::vector<std::thread>            m_workers;
+    std::vector<std::unique_ptr<Queue>> m_queues;  // one per worker + one shared by outside callers
+    std::atomic<size_t>                 m_pending{ 0 };
+    std::atomic<uint64_t>               m_pushes{ 0 }; // parallelFor calls that queued tasks
+    std::mutex                          m_mutex;
+    std::condition_variable             m_cv;      // tasks queued / batch finished / stopping
+    bool                                m_stop = false;
+};
+
+} // namespace lodgen
@@ -11,9 +11,17 @@ namespace lodgen
 
 namespace fs = std::filesystem;
 
+// Defined in face_arena.cpp: lodgen-written meshes keep their face indices in
+// one block that must be handed back before assimp frees the scene.
+void releaseFaceArenas( const aiScene* scene );
+
 struct AiSceneDeleter
 {
-    void operator()( const aiScene* scene ) const { aiFreeScene( scene ); }
+    void operator()( const aiScene* scene ) const
+    {
+        releaseFaceArenas( scene );
+        aiFreeScene( scene );
+    }
 };
 
 using ScenePtr        = std::unique_ptr<const aiScene, AiSceneDeleter>;
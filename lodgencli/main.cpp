@@ -1,13 +1,268 @@
 #include <lodgen/lodgen.hpp>
 #include <lodgen/scene_io.hpp>
+#include <lodgen/stopwatch.hpp>
 #include <cxxopts.hpp>
+#include <algorithm>
+#include <cstdio>
 #include <filesystem>
+#include <fstream>
 #include <iostream>
+#include <optional>
+#include <set>
 #include <string>
 #include <vector>
 
 namespace fs = std::filesystem;
 
+// With decodeRuns, compressed LODs are decoded that many times and the
+// throughput is printed.
+static void printLods( const std::vector<lodgen::LodInfo>& lods, unsigned int decodeRuns = 0 )
+{
+    for ( const auto& info : lods )
+    {
+        std::cout << "lod (ratio=" << info.ratio << ", achieved " << lodgen::achievedRatio( info )
+                  << ", error " << lodgen::achievedError( info ) << "): " << info.outputPath.string() << "\n";
+        for ( size_t i = 0; i < info.meshResults.size(); ++i )
+        {
+            const auto& m = info.meshResults[i];
+            std::cout << "  mesh[" << i << "] " << m.simplifiedTriangles;
+            if ( m.targetTriangles )
+                std::cout << "/" << m.targetTriangles;
+            std::cout << " tris (" << lodgen::engineName( m.engine ) << "), error " << m.accumulatedError << "\n";
+        }
+        if ( info.textureStats )
+            std::cout << "  textures: " << info.textureStats->outputCount
+                      << "/" << info.textureStats->inputCount << " processed\n";
+        for ( const auto& a : info.atlasInfos )
+            std::cout << "  atlas: " << a.filename << " (" << a.inputCount
+                      << " textures, " << a.width << "x" << a.height << ")\n";
+        if ( info.meshlets )
+            std::cout << "  meshlets: " << info.meshlets->path.filename().string() << " ("
+                      << info.meshlets->meshletCount << " meshlets)\n";
+        if ( info.instancing )
+            std::cout << "  instancing: " << info.instancing->meshesMerged << " meshes merged, "
+                      << info.instancing->instances << " instances on " << info.instancing->instancedNodes
+                      << " nodes\n";
+        if ( info.compression )
+            std::cout << "  compressed: " << info.compression->rawBytes << " -> "
+                      << info.compression->compressedBytes << " bytes (" << info.compression->streams
+                      << " buffer views)\n";
+        if ( info.compression && decodeRuns )
+        {
+            auto bench = lodgen::benchmarkDecode( info.outputPath, decodeRuns );
+            if ( !bench )
+                std::cout << "  decode: " << bench.error().message << "\n";
+            else if ( bench->seconds > 0 )
+                std::cout << "  decode: " << bench->decodedBytes * bench->iterations / bench->seconds / 1e9
+                          << " GB/s (" << bench->seconds * 1e3 / bench->iterations << " ms per load)\n";
+        }
+    }
+}
+
+// ── JSON report ───────────────────────────────────────────────────────────────
+
+static std::string jsonString( const std::string& s )
+{
+    std::string out = "\"";
+    for ( char c : s )
+    {
+        switch ( c )
+        {
+        case '"':  out += "\\\""; break;
+        case '\\': out += "\\\\"; break;
+        case '\n': out += "\\n"; break;
+        case '\r': out += "\\r"; break;
+        case '\t': out += "\\t"; break;
+        default:
+            if ( static_cast<unsigned char>( c ) < 0x20 )
+            {
+                char buf[8];
+                std::snprintf( buf, sizeof( buf ), "\\u%04x", c );
+                out += buf;
+            }
+            else
+            {
+                out += c;
+            }
+        }
+    }
+    return out + "\"";
+}
+
+static void writeLodJson( std::ostream& out, const lodgen::LodInfo& info )
+{
+    const auto& t = info.timings;
+    out << "        {\"ratio\": " << info.ratio << ", \"achievedRatio\": " << lodgen::achievedRatio( info )
+        << ", \"achievedError\": " << lodgen::achievedError( info )
+        << ", \"output\": " << jsonString( info.outputPath.generic_string() )
+        << ", \"fromCache\": " << ( info.fromCache ? "true" : "false" )
+        << ", \"bytesWritten\": " << info.bytesWritten << ",\n"
+        << "         \"seconds\": {\"copy\": " << t.copy << ", \"simplify\": " << t.simplify
+        << ", \"textures\": " << t.textures << ", \"atlas\": " << t.atlas
+        << ", \"save\": " << t.save << ", \"meshlets\": " << t.meshlets << "},\n";
+
+    if ( info.textureStats )
+    {
+        const auto& ts = *info.textureStats;
+        out << "         \"textures\": {\"inputs\": " << ts.inputCount << ", \"outputs\": " << ts.outputCount
+            << ", \"bytesWritten\": " << ts.bytesWritten << ", \"decodeSeconds\": " << ts.decodeSeconds
+            << ", \"resizeSeconds\": " << ts.resizeSeconds << ", \"encodeSeconds\": " << ts.encodeSeconds
+            << "},\n";
+    }
+
+    if ( info.instancing )
+        out << "         \"instancing\": {\"meshesMerged\": " << info.instancing->meshesMerged
+            << ", \"instancedNodes\": " << info.instancing->instancedNodes
+            << ", \"instances\": " << info.instancing->instances << "},\n";
+
+    if ( info.compression )
+        out << "         \"compression\": {\"rawBytes\": " << info.compression->rawBytes
+            << ", \"compressedBytes\": " << info.compression->compressedBytes
+            << ", \"streams\": " << info.compression->streams << "},\n";
+
+    if ( info.meshlets )
+        out << "         \"meshlets\": {\"file\": " << jsonString( info.meshlets->path.generic_string() )
+            << ", \"count\": " << info.meshlets->meshletCount << "},\n";
+
+    out << "         \"atlases\": [";
+    for ( size_t i = 0; i < info.atlasInfos.size(); ++i )
+    {
+        const auto& a = info.atlasInfos[i];
+        out << ( i ? ", " : "" ) << "{\"file\": " << jsonString( a.filename ) << ", \"inputs\": "
+            << a.inputCount << ", \"width\": " << a.width << ", \"height\": " << a.height << "}";
+    }
+    out << "],\n";
+
+    out << "         \"meshes\": [";
+    for ( size_t i = 0; i < info.meshResults.size(); ++i )
+    {
+        const auto& m = info.meshResults[i];
+        out << ( i ? "," : "" ) << "\n           {\"engine\": " << jsonString( lodgen::engineName( m.engine ) )
+            << ", \"triangles\": [" << m.originalTriangles << ", "
+            << m.simplifiedTriangles << "], \"targetTriangles\": " << m.targetTriangles
+            << ", \"vertices\": [" << m.originalVertices << ", "
+            << m.simplifiedVertices << "], \"error\": " << m.error
+            << ", \"accumulatedError\": " << m.accumulatedError
+            << ", \"seconds\": {\"simplify\": " << m.simplifySeconds << ", \"optimize\": "
+            << m.optimizeSeconds << ", \"compact\": " << m.compactSeconds << "}}";
+    }
+    out << "]}";
+}
+
+// One entry per model; LOD / mesh fields mirror lodgen::LodInfo and
+// lodgen::SimplifyResult. Triangle and vertex pairs are [original, simplified].
+static bool writeReport( const fs::path& path, const std::vector<lodgen::BatchResult>& results,
+                         double totalSeconds )
+{
+    std::ofstream out( path );
+    if ( !out )
+        return false;
+
+    out << "{\n  \"version\": 1,\n  \"totalSeconds\": " << totalSeconds << ",\n  \"models\": [";
+    for ( size_t i = 0; i < results.size(); ++i )
+    {
+        const auto& r = results[i];
+        out << ( i ? "," : "" ) << "\n    {\"input\": " << jsonString( r.inputPath.generic_string() );
+        if ( !r.lods )
+        {
+            out << ", \"error\": " << jsonString( r.lods.error().message ) << "}";
+            continue;
+        }
+        out << ", \"lods\": [";
+        for ( size_t l = 0; l < r.lods->size(); ++l )
+        {
+            out << ( l ? "," : "" ) << "\n";
+            writeLodJson( out, ( *r.lods )[l] );
+        }
+        out << "]}";
+    }
+    out << "\n  ]\n}\n";
+    return static_cast<bool>( out );
+}
+
+// Models to process for --batch: every importable file below a directory, or
+// the lines of a manifest file (blank lines and '#' comments skipped, relative
+// paths resolved against the manifest's directory). Each model writes to
+// outputDir/<path relative to the batch root, without extension>.
+static lodgen::Result<std::vector<lodgen::BatchJob>> collectBatchJobs(
+    const fs::path& source, const fs::path& outputDir )
+{
+    std::vector<std::pair<fs::path, fs::path>> models; // input, relative output
+    std::error_code ec;
+
+    if ( fs::is_directory( source, ec ) )
+    {
+        const fs::path outAbs = fs::weakly_canonical( outputDir, ec );
+        for ( auto it = fs::recursive_directory_iterator( source, ec );
+              !ec && it != fs::recursive_directory_iterator(); it.increment( ec ) )
+        {
+            // Never pick up our own output when it lives inside the batch root.
+            // Per-entry failures only skip the entry; `ec` drives the scan.
+            std::error_code entryEc;
+            if ( it->is_directory( entryEc ) )
+            {
+                const fs::path dir = fs::weakly_canonical( it->path(), entryEc );
+                if ( !entryEc && dir == outAbs )
+                    it.disable_recursion_pending();
+                continue;
+            }
+            if ( it->is_regular_file( entryEc ) && lodgen::isImportable( it->path() ) )
+                models.emplace_back( it->path(), fs::relative( it->path(), source ) );
+        }
+        if ( ec )
+            return std::unexpected( lodgen::Error{ lodgen::ErrorCode::FileNotFound,
+                "Could not scan " + source.string() + ": " + ec.message() } );
+        std::sort( models.begin(), models.end() );
+    }
+    else
+    {
+        std::ifstream manifest( source );
+        if ( !manifest )
+            return std::unexpected( lodgen::Error{ lodgen::ErrorCode::FileNotFound,
+                "Could not open manifest " + source.string() } );
+
+        std::string line;
+        while ( std::getline( manifest, line ) )
+        {
+            const auto first = line.find_first_not_of( " \t\r" );
+            if ( first == std::string::npos || line[first] == '#' )
+                continue;
+            const auto last = line.find_last_not_of( " \t\r" );
+            fs::path entry = line.substr( first, last - first + 1 );
+
+            if ( entry.is_absolute() )
+                models.emplace_back( entry, entry.filename() );
+            else
+                models.emplace_back( source.parent_path() / entry, entry );
+        }
+    }
+
+    // A model listed twice is processed once. a.obj and a.fbx side by side
+    // would share outputDir/a — keep the extension in the directory name for
+    // every model after the first, then count up until the name is free.
+    std::vector<lodgen::BatchJob> jobs;
+    std::set<fs::path> inputs;
+    std::set<fs::path> used;
+    for ( auto& [input, rel] : models )
+    {
+        std::error_code inputEc;
+        const fs::path canonical = fs::weakly_canonical( input, inputEc );
+        if ( !inputs.insert( inputEc ? input.lexically_normal() : canonical ).second )
+            continue;
+
+        const fs::path   stem = outputDir / fs::path( rel ).replace_extension();
+        const std::string ext = rel.extension().string();
+        fs::path dir = stem;
+        if ( used.count( dir ) && ext.size() > 1 )
+            dir = fs::path( stem ).concat( "_" + ext.substr( 1 ) );
+        for ( unsigned int n = 2; used.count( dir ); ++n )
+            dir = fs::path( stem ).concat( "_" + std::to_string( n ) );
+        used.insert( dir );
+        jobs.push_back( { std::move( input ), std::move( dir ) } );
+    }
+    return jobs;
+}
+
 int main( int argc, char* argv[] )
 {
     cxxopts::Options options( "lodgencli", "LOD generator — mesh simplification + optional texture processing" );
@@ -18,14 +273,62 @@ int main( int argc, char* argv[] )
             cxxopts::value<std::string>()->default_value( "output" ) )
         ( "r,ratios",  "Comma-separated LOD ratios, e.g. 0.5,0.25",
             cxxopts::value<std::string>()->default_value( "0.5,0.25" ) )
+        ( "errors",    "Comma-separated error limits, one per LOD; without --ratios the LODs are purely error-driven",
+            cxxopts::value<std::string>() )
+        ( "absolute-error", "Error limits and reported errors in model units instead of relative to mesh size",
+            cxxopts::value<bool>()->default_value( "false" ) )
+        ( "tri-budget",  "Comma-separated scene triangle budgets, one per LOD, split across meshes by error",
+            cxxopts::value<std::string>() )
+        ( "byte-budget", "Comma-separated scene vertex + index byte budgets, one per LOD",
+            cxxopts::value<std::string>() )
         ( "t,textures","Resize textures proportionally to each LOD ratio",
             cxxopts::value<bool>()->default_value( "false" ) )
-        ( "a,atlas",   "Build per-type texture atlases after LOD generation",
+        ( "a,atlas",   "Build per-type texture atlases for every LOD",
+            cxxopts::value<bool>()->default_value( "false" ) )
+        ( "j,jobs",    "LODs generated concurrently (0 = all cores)",
+            cxxopts::value<unsigned int>()->default_value( "1" ) )
+        ( "c,cascade", "Simplify each LOD from the previous one instead of the source",
+            cxxopts::value<bool>()->default_value( "false" ) )
+        ( "e,engine",  "Simplifier: quality, sloppy or auto; comma-separated for one per LOD",
+            cxxopts::value<std::string>()->default_value( "quality" ) )
+        ( "sloppy-above", "Triangle count above which --engine auto uses the sloppy simplifier",
+            cxxopts::value<unsigned int>()->default_value( "1000000" ) )
+        ( "chunk",     "Simplify meshes of twice this many triangles in parallel chunks (0 = never)",
+            cxxopts::value<unsigned int>()->default_value( "250000" ) )
+        ( "weld-seams", "Let UV / normal seams collapse: keep, normals (UV seams protected) or all",
+            cxxopts::value<std::string>()->default_value( "keep" ) )
+        ( "point-color-weight", "Weight of colour against position when decimating point clouds",
+            cxxopts::value<float>()->default_value( "1" ) )
+        ( "meshlets",  "Write meshlets with culling bounds next to every LOD (<lod file>.meshlets)",
+            cxxopts::value<bool>()->default_value( "false" ) )
+        ( "meshlet-size", "Max vertices and triangles per meshlet",
+            cxxopts::value<std::string>()->default_value( "64,124" ) )
+        ( "meshlet-spatial", "Build meshlets for ray tracing (spatial splits) instead of mesh shading",
+            cxxopts::value<bool>()->default_value( "false" ) )
+        ( "instance",  "Merge identical glTF / GLB meshes and instance repeated nodes (EXT_mesh_gpu_instancing)",
+            cxxopts::value<bool>()->default_value( "false" ) )
+        ( "quantize",  "Store glTF / GLB vertex attributes as normalized integers (KHR_mesh_quantization)",
+            cxxopts::value<bool>()->default_value( "false" ) )
+        ( "normal-bits", "Bits per normal / tangent component for --quantize: 8 or 16",
+            cxxopts::value<unsigned int>()->default_value( "8" ) )
+        ( "compress",  "Compress glTF / GLB buffers with meshoptimizer (EXT_meshopt_compression)",
+            cxxopts::value<bool>()->default_value( "false" ) )
+        ( "decode-bench", "Decode every compressed LOD this many times and print the throughput",
+            cxxopts::value<unsigned int>()->default_value( "0" ) )
+        ( "clusters",  "Write a cluster LOD hierarchy (<output>/<model>.clod) instead of discrete LODs",
             cxxopts::value<bool>()->default_value( "false" ) )
+        ( "cluster-size", "Max vertices and triangles per cluster for --clusters",
+            cxxopts::value<std::string>()->default_value( "64,124" ) )
+        ( "b,batch",   "Process every model in a directory, or listed in a manifest file",
+            cxxopts::value<std::string>() )
+        ( "cache",     "Build cache directory; unchanged models are restored from it",
+            cxxopts::value<std::string>() )
+        ( "report",    "Write per-stage timings and sizes as JSON to this file",
+            cxxopts::value<std::string>() )
         ( "h,help",    "Show help" );
 
     options.parse_positional( { "input" } );
-    options.positional_help( "<model>" );
+    options.positional_help( "<model> | --batch <dir|manifest>" );
 
     cxxopts::ParseResult args;
     try
@@ -38,7 +341,7 @@ int main( int argc, char* argv[] )
         return 1;
     }
 
-    if ( args.count( "help" ) || !args.count( "input" ) )
+    if ( args.count( "help" ) || args.count( "input" ) == args.count( "batch" ) )
     {
         std::cout << options.help() << "\n";
         return args.count( "help" ) ? 0 : 1;
@@ -46,90 +349,222 @@ int main( int argc, char* argv[] )
 
     // ── parse arguments ───────────────────────────────────────────────────────
 
-    fs::path inputPath  = args["input"].as<std::string>();
     fs::path outputDir  = args["output"].as<std::string>();
     bool     doTextures = args["textures"].as<bool>();
     bool     doAtlas    = args["atlas"].as<bool>();
+    unsigned jobs       = args["jobs"].as<unsigned int>();
+    bool     doCascade  = args["cascade"].as<bool>();
+    fs::path reportPath = args.count( "report" ) ? args["report"].as<std::string>() : std::string();
 
-    std::vector<float> ratios;
-    {
-        std::string ratioStr = args["ratios"].as<std::string>();
+    lodgen::Stopwatch totalWatch;
+
+    auto parseFloats = []( const std::string& list ) {
+        std::vector<float> values;
         std::string token;
-        for ( char c : ratioStr ) {
+        for ( char c : list ) {
             if ( c == ',' ) {
-                if ( !token.empty() ) ratios.push_back( std::stof( token ) );
+                if ( !token.empty() ) values.push_back( std::stof( token ) );
                 token.clear();
             } else {
                 token += c;
             }
         }
-        if ( !token.empty() ) ratios.push_back( std::stof( token ) );
+        if ( !token.empty() ) values.push_back( std::stof( token ) );
+        return values;
+    };
+
+    std::vector<float> maxErrors;
+    if ( args.count( "errors" ) )
+        maxErrors = parseFloats( args["errors"].as<std::string>() );
+
+    std::vector<lodgen::LodBudget> budgets;
+    for ( const char* name : { "tri-budget", "byte-budget" } )
+    {
+        if ( !args.count( name ) )
+            continue;
+        auto values = parseFloats( args[name].as<std::string>() );
+        budgets.resize( std::max( budgets.size(), values.size() ) );
+        for ( size_t i = 0; i < values.size(); ++i )
+            ( name[0] == 't' ? budgets[i].triangles : budgets[i].bytes ) = static_cast<uint64_t>( values[i] );
     }
+
+    // --errors or budgets alone: one LOD with ratio 0 (textures follow the
+    // achieved ratio) per limit.
+    std::vector<float> ratios;
+    if ( args.count( "ratios" ) || ( maxErrors.empty() && budgets.empty() ) )
+        ratios = parseFloats( args["ratios"].as<std::string>() );
+    else
+        ratios.assign( std::max( maxErrors.size(), budgets.size() ), 0.0f );
     if ( ratios.empty() )
     {
         std::cerr << "Error: no valid ratios specified\n";
         return 1;
     }
 
-    // ── load source scene ─────────────────────────────────────────────────────
-
-    auto sceneResult = lodgen::loadScene( inputPath );
-    if ( !sceneResult )
+    std::vector<lodgen::SimplifyEngine> engines;
     {
-        std::cerr << "Failed to load '" << inputPath.string() << "': "
-                  << sceneResult.error().message << "\n";
-        return 1;
+        std::string engineStr = args["engine"].as<std::string>() + ",";
+        std::string token;
+        for ( char c : engineStr ) {
+            if ( c != ',' ) {
+                token += c;
+                continue;
+            }
+            if ( token == "quality" )     engines.push_back( lodgen::SimplifyEngine::Quality );
+            else if ( token == "sloppy" ) engines.push_back( lodgen::SimplifyEngine::Sloppy );
+            else if ( token == "auto" )   engines.push_back( lodgen::SimplifyEngine::Auto );
+            else if ( !token.empty() )
+            {
+                std::cerr << "Error: unknown engine '" << token << "' (quality, sloppy or auto)\n";
+                return 1;
+            }
+            token.clear();
+        }
     }
-    const aiScene* scene = sceneResult->get();
 
-    // ── step 1: generate LODs ─────────────────────────────────────────────────
+    lodgen::SeamMode seams = lodgen::SeamMode::Keep;
+    {
+        const std::string mode = args["weld-seams"].as<std::string>();
+        if ( mode == "normals" )  seams = lodgen::SeamMode::WeldNormals;
+        else if ( mode == "all" ) seams = lodgen::SeamMode::WeldAll;
+        else if ( mode != "keep" )
+        {
+            std::cerr << "Error: unknown seam mode '" << mode << "' (keep, normals or all)\n";
+            return 1;
+        }
+    }
 
     lodgen::TextureOptions texOpts;
-    texOpts.modelDir       = inputPath.parent_path();
     texOpts.resizeTextures = true;
 
-    auto lodsResult = lodgen::generateLods(
-        scene, inputPath, outputDir, ratios,
-        doTextures ? &texOpts : nullptr );
-
-    if ( !lodsResult )
+    lodgen::LodOptions lodOpts;
+    lodOpts.workers = jobs;
+    lodOpts.cascade = doCascade;
+    lodOpts.atlas   = doAtlas;
+    lodOpts.lodEngines = std::move( engines );
+    lodOpts.maxErrors  = std::move( maxErrors );
+    lodOpts.budgets    = std::move( budgets );
+    lodOpts.simplify.sloppyTriangles = args["sloppy-above"].as<unsigned int>();
+    lodOpts.simplify.absoluteError   = args["absolute-error"].as<bool>();
+    lodOpts.simplify.chunkTriangles  = args["chunk"].as<unsigned int>();
+    lodOpts.simplify.seams           = seams;
+    lodOpts.simplify.pointColorWeight = args["point-color-weight"].as<float>();
+    if ( args["meshlets"].as<bool>() )
     {
-        std::cerr << "LOD generation failed: " << lodsResult.error().message << "\n";
-        return 1;
+        auto size = parseFloats( args["meshlet-size"].as<std::string>() );
+        auto& meshletOpts = lodOpts.meshlets.emplace();
+        if ( size.size() > 0 ) meshletOpts.maxVertices  = static_cast<unsigned int>( size[0] );
+        if ( size.size() > 1 ) meshletOpts.maxTriangles = static_cast<unsigned int>( size[1] );
+        meshletOpts.spatial = args["meshlet-spatial"].as<bool>();
     }
+    lodOpts.instance = args["instance"].as<bool>();
+    if ( args["quantize"].as<bool>() )
+        lodOpts.quantize.emplace().normalBits = args["normal-bits"].as<unsigned int>();
+    lodOpts.compress = args["compress"].as<bool>();
+    const unsigned int decodeRuns = args["decode-bench"].as<unsigned int>();
+
+    std::optional<lodgen::BuildCache> cache;
+    if ( args.count( "cache" ) )
+        lodOpts.cache = &cache.emplace( args["cache"].as<std::string>() );
+
+    // ── cluster LOD mode ──────────────────────────────────────────────────────
 
-    for ( const auto& info : *lodsResult )
+    if ( args["clusters"].as<bool>() )
     {
-        std::cout << "lod (ratio=" << info.ratio << "): " << info.outputPath.string() << "\n";
-        for ( size_t i = 0; i < info.meshResults.size(); ++i )
-            std::cout << "  mesh[" << i << "] "
-                      << info.meshResults[i].simplifiedTriangles << " tris\n";
-        if ( info.textureStats )
-            std::cout << "  textures: " << info.textureStats->outputCount
-                      << "/" << info.textureStats->inputCount << " processed\n";
+        if ( args.count( "batch" ) )
+        {
+            std::cerr << "Error: --clusters takes a single model\n";
+            return 1;
+        }
+        auto size = parseFloats( args["cluster-size"].as<std::string>() );
+        lodgen::ClusterLodOptions clusterOpts;
+        if ( size.size() > 0 ) clusterOpts.maxVertices  = static_cast<unsigned int>( size[0] );
+        if ( size.size() > 1 ) clusterOpts.maxTriangles = static_cast<unsigned int>( size[1] );
+
+        fs::path inputPath = args["input"].as<std::string>();
+        auto scene = lodgen::loadScene( inputPath );
+        if ( !scene )
+        {
+            std::cerr << "Error: " << scene.error().message << "\n";
+            return 1;
+        }
+
+        std::error_code ec;
+        fs::create_directories( outputDir, ec );
+        lodgen::ThreadPool pool( jobs );
+        auto info = lodgen::writeClusterLod(
+            scene->get(), outputDir / inputPath.stem().concat( ".clod" ), clusterOpts, &pool );
+        if ( !info )
+        {
+            std::cerr << "Cluster LOD failed: " << info.error().message << "\n";
+            return 1;
+        }
+        std::cout << "clusters: " << info->outputPath.string() << " (" << info->meshCount << " meshes, "
+                  << info->sourceTriangles << " tris, " << info->clusterCount << " clusters, "
+                  << info->levelCount << " levels, " << info->bytesWritten << " bytes)\n";
+        return 0;
     }
 
-    // ── step 2: build texture atlases (optional) ──────────────────────────────
+    // ── batch mode ────────────────────────────────────────────────────────────
 
-    if ( doAtlas )
+    if ( args.count( "batch" ) )
     {
-        for ( const auto& info : *lodsResult )
+        auto batchJobs = collectBatchJobs( args["batch"].as<std::string>(), outputDir );
+        if ( !batchJobs )
         {
-            lodgen::AtlasOptions atlasOpts;
-            atlasOpts.modelDir  = inputPath.parent_path();
-            atlasOpts.outputDir = info.outputPath.parent_path();
+            std::cerr << "Error: " << batchJobs.error().message << "\n";
+            return 1;
+        }
 
-            auto atlasResult = lodgen::buildLodAtlas( info.outputPath, atlasOpts );
-            if ( !atlasResult )
-            {
-                std::cerr << "Atlas failed for '" << info.outputPath.string() << "': "
-                          << atlasResult.error().message << "\n";
-                return 1;
-            }
-            for ( const auto& a : *atlasResult )
-                std::cout << "  atlas: " << a.filename << " (" << a.inputCount
-                          << " textures, " << a.width << "x" << a.height << ")\n";
+        size_t failed = 0;
+        auto results = lodgen::generateLodsBatch(
+            *batchJobs, ratios, doTextures ? &texOpts : nullptr, lodOpts,
+            [&]( const lodgen::BatchResult& r ) {
+                if ( r.lods )
+                {
+                    std::cout << "model: " << r.inputPath.string() << "\n";
+                    printLods( *r.lods, decodeRuns );
+                }
+                else
+                {
+                    ++failed;
+                    std::cerr << "Failed '" << r.inputPath.string() << "': "
+                              << r.lods.error().message << "\n";
+                }
+            } );
+
+        std::cout << "batch: " << batchJobs->size() - failed << "/" << batchJobs->size()
+                  << " models succeeded\n";
+
+        if ( !reportPath.empty() && !writeReport( reportPath, results, totalWatch.elapsed() ) )
+        {
+            std::cerr << "Error: could not write report " << reportPath.string() << "\n";
+            return 1;
         }
+        return failed ? 1 : 0;
+    }
+
+    // ── generate LODs (+ optional textures / atlases) ─────────────────────────
+
+    fs::path inputPath = args["input"].as<std::string>();
+
+    auto lodsResult = lodgen::generateLodsFromFile(
+        inputPath, outputDir, ratios,
+        doTextures ? &texOpts : nullptr, lodOpts );
+
+    if ( !lodsResult )
+    {
+        std::cerr << "LOD generation failed: " << lodsResult.error().message << "\n";
+        return 1;
+    }
+
+    printLods( *lodsResult, decodeRuns );
+
+    if ( !reportPath.empty() &&
+         !writeReport( reportPath, { { inputPath, std::move( lodsResult ) } }, totalWatch.elapsed() ) )
+    {
+        std::cerr << "Error: could not write report " << reportPath.string() << "\n";
+        return 1;
     }
 
     return 0;
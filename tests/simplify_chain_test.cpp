@@ -0,0 +1,87 @@
+#include "lodgen/mesh_simplifier.hpp"
+#include <array>
+#include <cstdio>
+#include <memory>
+
+// simplifyChain on a bumpy grid: one index buffer per ratio, each no larger
+// than the previous, all into the single compacted vertex buffer left in the
+// mesh, whose faces hold the first level.
+
+static std::unique_ptr<aiMesh> makeGrid( unsigned int n )
+{
+    auto mesh = std::make_unique<aiMesh>();
+    mesh->mPrimitiveTypes = aiPrimitiveType_TRIANGLE;
+    mesh->mNumVertices    = ( n + 1 ) * ( n + 1 );
+    mesh->mVertices       = new aiVector3D[mesh->mNumVertices];
+    for ( unsigned int y = 0; y <= n; ++y )
+        for ( unsigned int x = 0; x <= n; ++x )
+            mesh->mVertices[y * ( n + 1 ) + x] =
+                aiVector3D( float( x ) / n, float( y ) / n, 0.02f * float( ( x * 7 + y * 13 ) % 5 ) );
+
+    mesh->mNumFaces = n * n * 2;
+    mesh->mFaces    = new aiFace[mesh->mNumFaces];
+    unsigned int f  = 0;
+    for ( unsigned int y = 0; y < n; ++y )
+        for ( unsigned int x = 0; x < n; ++x )
+        {
+            const unsigned int v = y * ( n + 1 ) + x;
+            for ( auto tri : { std::array{ v, v + 1, v + n + 2 }, std::array{ v, v + n + 2, v + n + 1 } } )
+            {
+                aiFace& face     = mesh->mFaces[f++];
+                face.mNumIndices = 3;
+                face.mIndices    = new unsigned int[3]{ tri[0], tri[1], tri[2] };
+            }
+        }
+    return mesh;
+}
+
+int main()
+{
+    auto mesh = makeGrid( 64 );
+    const unsigned int sourceVertices = mesh->mNumVertices;
+
+    const float ratios[] = { 0.5f, 0.25f, 0.1f };
+    lodgen::SimplifyOptions opts;
+    opts.maxError = 1.0f;
+    const auto chain = lodgen::simplifyChain( mesh.get(), ratios, opts );
+
+    int failures = 0;
+    auto check = [&]( bool ok, const char* what ) {
+        if ( !ok )
+        {
+            std::fprintf( stderr, "%s\n", what );
+            ++failures;
+        }
+    };
+
+    check( chain.indexBuffers.size() == std::size( ratios ) && chain.results.size() == std::size( ratios ),
+           "one index buffer and result per ratio" );
+    if ( failures )
+        return 1;
+
+    check( mesh->mNumVertices > 0 && mesh->mNumVertices <= sourceVertices, "shared vertex buffer not compacted" );
+    for ( size_t i = 0; i < chain.indexBuffers.size(); ++i )
+    {
+        const auto& buffer = chain.indexBuffers[i];
+        check( !buffer.empty() && buffer.size() % 3 == 0, "index buffer is not a non-empty triangle list" );
+        check( i == 0 || buffer.size() <= chain.indexBuffers[i - 1].size(), "index counts increase along the chain" );
+        for ( unsigned int index : buffer )
+            if ( index >= mesh->mNumVertices )
+            {
+                check( false, "index outside the shared vertex buffer" );
+                break;
+            }
+        check( chain.results[i].simplifiedVertices == mesh->mNumVertices, "simplifiedVertices is not the shared size" );
+    }
+    check( chain.indexBuffers.back().size() < chain.indexBuffers.front().size(), "coarsest level not simplified" );
+
+    // The mesh's faces hold the first level.
+    const auto& first = chain.indexBuffers.front();
+    bool same = mesh->mNumFaces * 3 == first.size();
+    for ( unsigned int f = 0; same && f < mesh->mNumFaces; ++f )
+        for ( unsigned int k = 0; k < 3; ++k )
+            same = same && mesh->mFaces[f].mIndices[k] == first[f * 3 + k];
+    check( same, "mesh faces differ from the first level" );
+
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,52 @@
+#include "lodgen/thread_pool.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+
+// Nested parallelFor the way generateLodsBatch uses it: every outer (model)
+// task runs an inner (LOD / mesh) batch. A thread waiting on its inner batch
+// must not pick up further outer tasks, so no more outer tasks are in flight
+// than the pool has threads, and every index runs exactly once.
+
+int main()
+{
+    constexpr size_t kOuter = 2000;
+    constexpr size_t kInner = 5;
+
+    lodgen::ThreadPool pool( 4 );
+
+    std::atomic<int>    inFlight{ 0 };
+    std::atomic<int>    maxInFlight{ 0 };
+    std::atomic<size_t> innerRuns{ 0 };
+    std::atomic<size_t> outerRuns{ 0 };
+
+    pool.parallelFor( kOuter, [&]( size_t ) {
+        const int now = inFlight.fetch_add( 1 ) + 1;
+        int       seen = maxInFlight.load();
+        while ( now > seen && !maxInFlight.compare_exchange_weak( seen, now ) )
+        {
+        }
+
+        pool.parallelFor( kInner, [&]( size_t ) {
+            pool.parallelFor( 2, [&]( size_t ) { innerRuns.fetch_add( 1 ); } );
+        } );
+
+        outerRuns.fetch_add( 1 );
+        inFlight.fetch_sub( 1 );
+    } );
+
+    int failures = 0;
+    if ( outerRuns.load() != kOuter || innerRuns.load() != kOuter * kInner * 2 )
+    {
+        std::fprintf( stderr, "ran %zu outer / %zu inner tasks, expected %zu / %zu\n", outerRuns.load(),
+                      innerRuns.load(), kOuter, kOuter * kInner * 2 );
+        ++failures;
+    }
+    if ( maxInFlight.load() > static_cast<int>( pool.size() ) )
+    {
+        std::fprintf( stderr, "%d outer tasks in flight at once, pool has %u threads\n", maxInFlight.load(),
+                      pool.size() );
+        ++failures;
+    }
+    return failures ? 1 : 0;
+}